@@ -0,0 +1,14 @@
+# micro benchmarks for the image processing core, build with optimizations
+TEMPLATE = app
+CONFIG += console release
+CONFIG -= qt app_bundle
+
+include(../imagecore.pri)
+
+HEADERS += benchmark.h
+SOURCES += main.cpp \
+           colorbench.cpp \
+           pointbench.cpp \
+           parallelbench.cpp \
+           filterbench.cpp \
+           gaussbench.cpp
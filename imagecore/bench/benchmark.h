@@ -0,0 +1,51 @@
+#ifndef IMAGECORE_BENCHMARK_H
+#define IMAGECORE_BENCHMARK_H
+
+#include <chrono>
+#include <cstdio>
+
+#include "image.h"
+
+/*
+ * Minimal timing helpers shared by the benchmarks, every measurement is the
+ * best of a few runs over a full size test image.
+ */
+
+namespace benchmark
+{
+
+const int WIDTH = 6000;
+const int HEIGHT = 4000;
+const int RUNS = 5;
+
+template <typename Func>
+double measure(Func &&func)
+{
+    double best = 0;
+    for (int run = 0; run < RUNS; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < best)
+        {
+            best = elapsed.count();
+        }
+    }
+    return best;
+}
+
+inline void report(const char *name, double seconds, double pixels = WIDTH * (double)HEIGHT)
+{
+    printf("%-32s %8.2f ms %8.1f MPixel/s\n", name, seconds * 1000, pixels / seconds / 1e6);
+}
+
+void color(const imagecore::Image &source);
+void pointOperations(const imagecore::Image &source);
+void parallel(const imagecore::Image &source);
+void filter(const imagecore::Image &source);
+void gaussian(const imagecore::Image &source);
+
+} // namespace benchmark
+
+#endif
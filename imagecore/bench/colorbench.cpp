@@ -0,0 +1,49 @@
+#include "benchmark.h"
+#include "color.h"
+#include "cpu.h"
+#include "iterate.h"
+
+using namespace imagecore;
+
+// per-pixel functions against the batch conversion on every supported instruction set
+void benchmark::color(const Image &source)
+{
+    int width = source.width();
+    int height = source.height();
+    LumaPlane y(width, height);
+    Plane<uint8_t> cb(width, height);
+    Plane<uint8_t> cr(width, height);
+    Image target(width, height);
+
+    report("per pixel forward", measure([&]() {
+        iteratePixels(source, [&](int x, int row) {
+            auto color = rgbToYCbCr(source(x, row));
+            y(x, row) = std::get<0>(color);
+            cb(x, row) = std::get<1>(color);
+            cr(x, row) = std::get<2>(color);
+        });
+    }));
+    report("per pixel inverse", measure([&]() {
+        iteratePixels(source, [&](int x, int row) {
+            target(x, row) = yCbCrToRgb(std::tuple<int, int, int>(y(x, row), cb(x, row), cr(x, row)));
+        });
+    }));
+
+    SimdLevel supported = detectSimdLevel();
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2})
+    {
+        if (level > supported)
+        {
+            break;
+        }
+        setSimdLevel(level);
+        char name[64];
+        snprintf(name, sizeof(name), "batch forward %s", simdLevelName(level));
+        report(name, measure([&]() { rgbToYCbCr(source, y, cb, cr); }));
+        snprintf(name, sizeof(name), "batch gray %s", simdLevelName(level));
+        report(name, measure([&]() { rgbToGray(source, y); }));
+        snprintf(name, sizeof(name), "batch inverse %s", simdLevelName(level));
+        report(name, measure([&]() { yCbCrToRgb(y, cb, cr, target); }));
+    }
+    setSimdLevel(supported);
+}
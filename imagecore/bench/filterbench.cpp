@@ -0,0 +1,132 @@
+#include "benchmark.h"
+#include "convolve.h"
+#include "cpu.h"
+#include "fft.h"
+#include "filter.h"
+#include "iterate.h"
+
+#include <vector>
+
+using namespace imagecore;
+
+// per-pixel tap loops against the convolution kernels on every supported instruction set
+void benchmark::filter(const Image &source)
+{
+    LumaPlane luma = toYCbCr(source).y;
+    int width = luma.width();
+    int height = luma.height();
+    Eigen::VectorXd kernel = createGaussianKernel(2.0);
+    int h = (int)kernel.size() / 2;
+    Plane<double> buffer(width, height);
+    LumaPlane target(width, height);
+
+    report("gauss sigma 2 per pixel", measure([&]() {
+        iteratePixels(luma, [&](int x, int y) {
+            double total = 0;
+            for (int i = 0; i < kernel.size(); i++)
+            {
+                int x_pos = x - h + i;
+                total += kernel(i) * (x_pos < 0 || x_pos > width - 1 ? borderMirror(x_pos, y, luma) : luma(x_pos, y));
+            }
+            buffer(x, y) = (int)(total / kernel.sum());
+        });
+        iteratePixels(luma, [&](int x, int y) {
+            double total = 0;
+            for (int i = 0; i < kernel.size(); i++)
+            {
+                int y_pos = y - h + i;
+                total += kernel(i) * (y_pos < 0 || y_pos > height - 1 ? borderMirror(x, y_pos, luma) : buffer(x, y_pos));
+            }
+            target(x, y) = toLuma(total / kernel.sum());
+        });
+    }));
+
+    Eigen::VectorXd box = Eigen::VectorXd::Ones(5);
+    FilterOptions options;
+    options.borderStrategy = borderMirror;
+    Eigen::MatrixXd laplace(3, 3);
+    laplace << 0, 1, 0, 1, -4, 1, 0, 1, 0;
+    report("laplace 3x3 (not separable)", measure([&]() { applyFilter(laplace, luma, options); }));
+
+    // the direct loop against the FFT around FFT_MIN_TAPS, the kernels have rank > 1
+    for (int size : {21, 25, 31})
+    {
+        Eigen::MatrixXd kernel2D(size, size);
+        for (int i = 0; i < kernel2D.size(); i++)
+        {
+            kernel2D(i) = (i * 7919) % 23 - 11;
+        }
+        std::vector<double> weights(kernel2D.size());
+        for (int v = 0; v < size; v++)
+        {
+            for (int u = 0; u < size; u++)
+            {
+                weights[v * size + u] = kernel2D(v, u);
+            }
+        }
+        Plane<float> padded = padPlane(luma, size / 2, size / 2, size / 2, size / 2, borderMirror);
+        Plane<double> response(width, height);
+        char name[64];
+        snprintf(name, sizeof(name), "%dx%d direct", size, size);
+        report(name, measure([&]() {
+            parallelBands(width, height, [&](int begin, int end) {
+                std::vector<const float *> rows(size);
+                for (int y = begin; y < end; y++)
+                {
+                    for (int v = 0; v < size; v++)
+                    {
+                        rows[v] = padded.row(y + v);
+                    }
+                    convolve2D(rows.data(), weights.data(), size, size, response.row(y), width);
+                }
+            });
+        }));
+        snprintf(name, sizeof(name), "%dx%d fft", size, size);
+        report(name, measure([&]() { fftFilter(padded, kernel2D, response); }));
+        // the whole of applyFilter(), the integer taps in the integer loop, the shifted ones like above
+        Eigen::MatrixXd shifted = kernel2D.array() + 0.5;
+        snprintf(name, sizeof(name), "%dx%d applyFilter integer", size, size);
+        report(name, measure([&]() { applyFilter(kernel2D, luma, options); }));
+        snprintf(name, sizeof(name), "%dx%d applyFilter float", size, size);
+        report(name, measure([&]() { applyFilter(shifted, luma, options); }));
+    }
+
+    Plane<float> I_x(width, height);
+    Plane<float> I_y(width, height);
+    Plane<float> E_mag(width, height);
+    // the kernels of the filter table, applyFilter() sums them in integers
+    Eigen::MatrixXd box3 = Eigen::MatrixXd::Ones(3, 3);
+    Eigen::MatrixXd box5 = Eigen::MatrixXd::Ones(5, 5);
+    Eigen::VectorXd binomial(5);
+    binomial << 1, 4, 6, 4, 1;
+    Eigen::MatrixXd binomial5 = binomial * binomial.transpose();
+    Eigen::MatrixXd sobel(3, 3);
+    sobel << 1, 0, -1, 2, 0, -2, 1, 0, -1;
+    FilterOptions derivation = options;
+    derivation.isDerivationFilter = true;
+    SimdLevel supported = detectSimdLevel();
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2})
+    {
+        if (level > supported)
+        {
+            break;
+        }
+        setSimdLevel(level);
+        char name[64];
+        snprintf(name, sizeof(name), "gauss sigma 2 %s", simdLevelName(level));
+        report(name, measure([&]() { applyGaussianFilter(2.0, luma, borderMirror); }));
+        snprintf(name, sizeof(name), "box 5x5 %s", simdLevelName(level));
+        report(name, measure([&]() { applySeparatedFilter(box, box, luma, options); }));
+        snprintf(name, sizeof(name), "box 3x3 integer %s", simdLevelName(level));
+        report(name, measure([&]() { applyFilter(box3, luma, options); }));
+        snprintf(name, sizeof(name), "box 5x5 integer %s", simdLevelName(level));
+        report(name, measure([&]() { applyFilter(box5, luma, options); }));
+        snprintf(name, sizeof(name), "binomial 5x5 integer %s", simdLevelName(level));
+        report(name, measure([&]() { applyFilter(binomial5, luma, options); }));
+        snprintf(name, sizeof(name), "sobel x integer %s", simdLevelName(level));
+        report(name, measure([&]() { applyFilter(sobel, luma, derivation); }));
+        snprintf(name, sizeof(name), "gradient %s", simdLevelName(level));
+        report(name, measure([&]() { calculateGradient(luma, borderMirror, I_x, I_y, E_mag); }));
+    }
+    setSimdLevel(supported);
+}
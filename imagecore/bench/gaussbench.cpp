@@ -0,0 +1,43 @@
+#include <cstdlib>
+
+#include "benchmark.h"
+#include "filter.h"
+#include "gaussian.h"
+#include "iterate.h"
+
+using namespace imagecore;
+
+// kernel against recursive filter, the accuracy report shows how far the IIR result is off the FIR reference
+void benchmark::gaussian(const Image &source)
+{
+    LumaPlane luma = toYCbCr(source).y;
+    // noise has no structure to blur, so the accuracy is measured on a smooth gradient with edges as well
+    LumaPlane pattern(luma.width(), luma.height());
+    iteratePixels(pattern, [&pattern, &luma](int x, int y) {
+        pattern(x, y) = ((x / 64 + y / 64) % 2 ? x / 32 : 255 - y / 24) % 256 / 2 + luma(x, y) / 2;
+    });
+
+    for (double sigma : {1.0, 2.0, 3.0, 4.0, 6.0, 8.0, 16.0})
+    {
+        char name[64];
+        LumaPlane fir;
+        LumaPlane iir;
+        snprintf(name, sizeof(name), "gauss sigma %g FIR", sigma);
+        report(name, measure([&]() { fir = applyGaussianFilter(sigma, pattern, borderMirror, GaussianMethod::FIR); }));
+        snprintf(name, sizeof(name), "gauss sigma %g IIR", sigma);
+        report(name, measure([&]() { iir = applyGaussianFilter(sigma, pattern, borderMirror, GaussianMethod::IIR); }));
+
+        int maxError = 0;
+        long errors = 0;
+        long sum = 0;
+        iteratePixels(fir, [&](int x, int y) {
+            int error = std::abs(fir(x, y) - iir(x, y));
+            maxError = std::max(maxError, error);
+            errors += error > 0;
+            sum += error;
+        });
+        double pixels = fir.width() * (double)fir.height();
+        printf("  IIR error at sigma %-4g max %d, mean %.3f, %.1f%% of the pixels differ%s\n", sigma, maxError, sum / pixels,
+               100 * errors / pixels, selectGaussianMethod(sigma) == GaussianMethod::IIR ? " (selected)" : "");
+    }
+}
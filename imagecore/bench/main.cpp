@@ -0,0 +1,40 @@
+#include <cstring>
+#include <random>
+
+#include "benchmark.h"
+#include "cpu.h"
+#include "iterate.h"
+
+// usage: bench [name], runs every benchmark if no name is given
+int main(int argc, char **argv)
+{
+    imagecore::Image source(benchmark::WIDTH, benchmark::HEIGHT);
+    std::mt19937 random(42);
+    imagecore::iteratePixels(source, [&source, &random](int x, int y) {
+        source(x, y) = 0xff000000 | (random() & 0xffffff);
+    });
+    printf("detected instruction set: %s\n", imagecore::simdLevelName(imagecore::detectSimdLevel()));
+
+    const char *name = argc > 1 ? argv[1] : nullptr;
+    if (name == nullptr || strcmp(name, "color") == 0)
+    {
+        benchmark::color(source);
+    }
+    if (name == nullptr || strcmp(name, "point") == 0)
+    {
+        benchmark::pointOperations(source);
+    }
+    if (name == nullptr || strcmp(name, "parallel") == 0)
+    {
+        benchmark::parallel(source);
+    }
+    if (name == nullptr || strcmp(name, "filter") == 0)
+    {
+        benchmark::filter(source);
+    }
+    if (name == nullptr || strcmp(name, "gauss") == 0)
+    {
+        benchmark::gaussian(source);
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include <thread>
+#include <vector>
+
+#include "benchmark.h"
+#include "canny.h"
+#include "filter.h"
+#include "operations.h"
+#include "parallel.h"
+
+using namespace imagecore;
+
+// the same operations with a growing number of threads
+void benchmark::parallel(const Image &source)
+{
+    YCbCrImage planes = toYCbCr(source);
+    Histogram hist = createHistogram(planes.y);
+    Adjustments adjustments;
+    adjustments.contrast = 40;
+    Image target(source.width(), source.height());
+
+    int cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> counts;
+    for (int threads = 1; threads < cores; threads *= 2)
+    {
+        counts.push_back(threads);
+    }
+    counts.push_back(cores);
+    for (int threads : counts)
+    {
+        setThreadCount(threads);
+        char name[64];
+        snprintf(name, sizeof(name), "gauss sigma 2, %d threads", threads);
+        report(name, measure([&]() { applyGaussianFilter(2.0, planes.y, borderMirror); }));
+        snprintf(name, sizeof(name), "adjustments, %d threads", threads);
+        report(name, measure([&]() { applyLuts(adjustmentLut(adjustments, hist), identityLut(), planes, target); }));
+        snprintf(name, sizeof(name), "canny, %d threads", threads);
+        report(name, measure([&]() { applyCannyAlgorithm(planes.y, 1.4, 1.5, 3.0, borderMirror); }));
+    }
+    setThreadCount(0);
+}
@@ -0,0 +1,66 @@
+#include "benchmark.h"
+#include "cpu.h"
+#include "iterate.h"
+#include "lut.h"
+#include "operations.h"
+
+using namespace imagecore;
+
+// formula per pixel against the lookup tables
+void benchmark::pointOperations(const Image &source)
+{
+    YCbCrImage planes = toYCbCr(source);
+    Histogram hist = createHistogram(planes.y);
+    LumaPlane target(source.width(), source.height());
+    Image rgbTarget(source.width(), source.height());
+
+    report("contrast per pixel", measure([&]() {
+        double factor = 1.5;
+        int b = 128;
+        transformPixels(planes.y, target, [factor, b](int16_t luma) {
+            int intensity = (int)((luma - b) * factor) + b;
+            return toLuma(intensity > 255 ? 255 : intensity);
+        });
+    }));
+    report("quantize per pixel", measure([&]() {
+        int div = 16;
+        transformPixels(source, rgbTarget, [div](Rgb color) {
+            return rgb((red(color) / div) * div, (green(color) / div) * div, (blue(color) / div) * div);
+        });
+    }));
+
+    SimdLevel supported = detectSimdLevel();
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2})
+    {
+        if (level > supported)
+        {
+            break;
+        }
+        setSimdLevel(level);
+        char name[64];
+        Lut contrast = contrastLut(hist, 50);
+        snprintf(name, sizeof(name), "contrast lut %s", simdLevelName(level));
+        report(name, measure([&]() { applyLut(contrast, planes.y, target); }));
+        Lut quantization = quantizationLut(4);
+        snprintf(name, sizeof(name), "quantize lut %s", simdLevelName(level));
+        report(name, measure([&]() { applyChannelLut(quantization, source, rgbTarget); }));
+    }
+    setSimdLevel(supported);
+
+    Adjustments adjustments;
+    adjustments.brightness = 20;
+    adjustments.contrast = 40;
+    adjustments.robustContrast = 10;
+    adjustments.quantization = 5;
+    // the contrast leaves dark luma below 0, createHistogram() counts it as black like mapHistogram() in the fused
+    // path, so both build the same tables and produce the same image
+    report("adjustments one by one", measure([&]() {
+        LumaPlane luma = changeBrightness(planes.y, adjustments.brightness);
+        luma = changeContrast(luma, createHistogram(luma), adjustments.contrast);
+        luma = changeRobustContrast(luma, createHistogram(luma), adjustments.robustContrast);
+        quantizeImage(toRgb(luma, planes), adjustments.quantization);
+    }));
+    report("adjustments fused", measure([&]() {
+        applyLuts(adjustmentLut(adjustments, hist), quantizationLut(adjustments.quantization), planes, rgbTarget);
+    }));
+}
@@ -0,0 +1,127 @@
+#ifndef IMAGECORE_BORDER_H
+#define IMAGECORE_BORDER_H
+
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+
+#include "color.h"
+#include "plane.h"
+
+/*
+ * Border policies return the luma at a position outside of the plane. They
+ * are the compile-time counterparts of borderPad(), borderConstant() and
+ * borderMirror(), so loops instantiated with them inline the border instead
+ * of calling through a std::function. withBorderPolicy() picks the policy for
+ * a runtime BorderStrategy once per call, padRow() fills the halo of a row.
+ */
+
+namespace imagecore
+{
+
+// filters only read the luma, a border strategy returns the luma outside of the plane
+typedef std::function<int(int, int, const LumaPlane &)> BorderStrategy;
+
+int borderPad(int x, int y, const LumaPlane &image);
+int borderConstant(int x, int y, const LumaPlane &image);
+int borderMirror(int x, int y, const LumaPlane &image);
+
+// luma of black
+struct PadBorder
+{
+    int value = rgbToGray(0, 0, 0);
+
+    int operator()(int, int, const LumaPlane &) const
+    {
+        return value;
+    }
+};
+
+// nearest pixel on the edge
+struct ConstantBorder
+{
+    int operator()(int x, int y, const LumaPlane &image) const
+    {
+        return image(std::clamp(x, 0, image.width() - 1), std::clamp(y, 0, image.height() - 1));
+    }
+};
+
+// reflection about the first pixel at the near edges (x = -1 reads 1) but about the outer edge of the
+// last pixel at the far edges (x = width reads width - 1), positions past the opposite edge are clamped
+struct MirrorBorder
+{
+    static int reflect(int pos, int size)
+    {
+        pos = pos < 0 ? -pos : pos > size - 1 ? 2 * size - 1 - pos : pos;
+        return std::clamp(pos, 0, size - 1);
+    }
+
+    int operator()(int x, int y, const LumaPlane &image) const
+    {
+        return image(reflect(x, image.width()), reflect(y, image.height()));
+    }
+};
+
+// any other strategy, called through the std::function
+struct FunctionBorder
+{
+    const BorderStrategy &strategy;
+
+    int operator()(int x, int y, const LumaPlane &image) const
+    {
+        return strategy(x, y, image);
+    }
+};
+
+// calls func with the policy of borderStrategy
+template <typename Func>
+void withBorderPolicy(const BorderStrategy &borderStrategy, Func &&func)
+{
+    typedef int (*Function)(int, int, const LumaPlane &);
+    const Function *function = borderStrategy.target<Function>();
+    if (function != nullptr && *function == borderPad)
+    {
+        func(PadBorder());
+    }
+    else if (function != nullptr && *function == borderConstant)
+    {
+        func(ConstantBorder());
+    }
+    else if (function != nullptr && *function == borderMirror)
+    {
+        func(MirrorBorder());
+    }
+    else
+    {
+        func(FunctionBorder{borderStrategy});
+    }
+}
+
+// row y of the luma as T (float or the luma itself) with left and right border values around it,
+// rows outside of the plane are border values only
+template <typename Border, typename T>
+void padRow(const LumaPlane &source, int y, int left, int right, const Border &border, T *padded)
+{
+    int width = source.width();
+    if (y < 0 || y > source.height() - 1)
+    {
+        for (int x = 0; x < left + width + right; x++)
+        {
+            padded[x] = border(x - left, y, source);
+        }
+        return;
+    }
+    for (int x = 0; x < left; x++)
+    {
+        padded[x] = border(x - left, y, source);
+    }
+    std::copy(source.row(y), source.row(y) + width, padded + left);
+    for (int x = width; x < width + right; x++)
+    {
+        padded[left + x] = border(x, y, source);
+    }
+}
+
+} // namespace imagecore
+
+#endif
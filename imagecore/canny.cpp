@@ -0,0 +1,479 @@
+#include "canny.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "cpu.h"
+#include "iterate.h"
+
+#ifdef IMAGECORE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace imagecore
+{
+
+// tan(22.5 degrees), the sector borders lie at 22.5 degrees from the axes
+static const float TAN_PI_8 = 0.41421356f;
+
+static void orientationSectorsScalar(const float *d_x, const float *d_y, uint8_t *sectors, int width, int offset)
+{
+    for (int x = offset; x < width; x++)
+    {
+        float a_x = std::abs(d_x[x]);
+        float a_y = std::abs(d_y[x]);
+        int diagonal = d_x[x] * d_y[x] > 0 ? 1 : 3;
+        sectors[x] = a_y <= TAN_PI_8 * a_x ? 0 : a_x < TAN_PI_8 * a_y ? 2 : diagonal;
+    }
+}
+
+int getOrientationSector(double &d_x, double &d_y)
+{
+    float f_x = (float)d_x;
+    float f_y = (float)d_y;
+    uint8_t sector;
+    orientationSectorsScalar(&f_x, &f_y, &sector, 1, 0);
+    return sector;
+}
+
+#ifdef IMAGECORE_X86_SIMD
+
+// sector of four pixels as 32 bit integers, the comparisons pick 0, 2 or the diagonal like the scalar code
+static inline __m128i sse2Sectors(__m128 d_x, __m128 d_y)
+{
+    __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 tan = _mm_set1_ps(TAN_PI_8);
+    __m128 a_x = _mm_andnot_ps(sign, d_x);
+    __m128 a_y = _mm_andnot_ps(sign, d_y);
+    __m128i horizontal = _mm_castps_si128(_mm_cmple_ps(a_y, _mm_mul_ps(tan, a_x)));
+    __m128i vertical = _mm_castps_si128(_mm_cmplt_ps(a_x, _mm_mul_ps(tan, a_y)));
+    __m128i falling = _mm_castps_si128(_mm_cmpgt_ps(_mm_mul_ps(d_x, d_y), _mm_setzero_ps()));
+    // 3 - 2 for a falling diagonal, then 2 for vertical and 0 for horizontal gradients
+    __m128i sector = _mm_add_epi32(_mm_set1_epi32(3), _mm_add_epi32(falling, falling));
+    sector = _mm_or_si128(_mm_and_si128(vertical, _mm_set1_epi32(2)), _mm_andnot_si128(vertical, sector));
+    return _mm_andnot_si128(horizontal, sector);
+}
+
+static void orientationSectorsSSE2(const float *d_x, const float *d_y, uint8_t *sectors, int width)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i s0 = sse2Sectors(_mm_loadu_ps(d_x + x), _mm_loadu_ps(d_y + x));
+        __m128i s1 = sse2Sectors(_mm_loadu_ps(d_x + x + 4), _mm_loadu_ps(d_y + x + 4));
+        __m128i s2 = sse2Sectors(_mm_loadu_ps(d_x + x + 8), _mm_loadu_ps(d_y + x + 8));
+        __m128i s3 = sse2Sectors(_mm_loadu_ps(d_x + x + 12), _mm_loadu_ps(d_y + x + 12));
+        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(s0, s1), _mm_packs_epi32(s2, s3));
+        _mm_storeu_si128((__m128i *)(sectors + x), bytes);
+    }
+    orientationSectorsScalar(d_x, d_y, sectors, width, x);
+}
+
+IMAGECORE_TARGET_AVX2 static inline __m256i avx2Sectors(__m256 d_x, __m256 d_y)
+{
+    __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 tan = _mm256_set1_ps(TAN_PI_8);
+    __m256 a_x = _mm256_andnot_ps(sign, d_x);
+    __m256 a_y = _mm256_andnot_ps(sign, d_y);
+    __m256i horizontal = _mm256_castps_si256(_mm256_cmp_ps(a_y, _mm256_mul_ps(tan, a_x), _CMP_LE_OQ));
+    __m256i vertical = _mm256_castps_si256(_mm256_cmp_ps(a_x, _mm256_mul_ps(tan, a_y), _CMP_LT_OQ));
+    __m256i falling = _mm256_castps_si256(_mm256_cmp_ps(_mm256_mul_ps(d_x, d_y), _mm256_setzero_ps(), _CMP_GT_OQ));
+    __m256i sector = _mm256_add_epi32(_mm256_set1_epi32(3), _mm256_add_epi32(falling, falling));
+    sector = _mm256_blendv_epi8(sector, _mm256_set1_epi32(2), vertical);
+    return _mm256_andnot_si256(horizontal, sector);
+}
+
+// the packs work within 128 bit lanes, the permute puts the 16 bit sectors back in order
+IMAGECORE_TARGET_AVX2 static void orientationSectorsAVX2(const float *d_x, const float *d_y, uint8_t *sectors, int width)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i s0 = avx2Sectors(_mm256_loadu_ps(d_x + x), _mm256_loadu_ps(d_y + x));
+        __m256i s1 = avx2Sectors(_mm256_loadu_ps(d_x + x + 8), _mm256_loadu_ps(d_y + x + 8));
+        __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(s0, s1), 0xD8);
+        __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128((__m128i *)(sectors + x), bytes);
+    }
+    orientationSectorsScalar(d_x, d_y, sectors, width, x);
+}
+
+#endif
+
+void orientationSectors(const float *d_x, const float *d_y, uint8_t *sectors, int width)
+{
+    switch (simdLevel())
+    {
+#ifdef IMAGECORE_X86_SIMD
+    case SimdLevel::AVX2:
+        orientationSectorsAVX2(d_x, d_y, sectors, width);
+        break;
+    case SimdLevel::SSE2:
+        orientationSectorsSSE2(d_x, d_y, sectors, width);
+        break;
+#endif
+    default:
+        orientationSectorsScalar(d_x, d_y, sectors, width, 0);
+    }
+}
+
+// magnitude row (-1, 0 or 1 from y) and x offset of the two neighbors across the edge per sector
+struct SectorNeighbors
+{
+    int row_L;
+    int x_L;
+    int row_R;
+    int x_R;
+};
+
+static const SectorNeighbors SECTOR_NEIGHBORS[4] = {
+    {0, -1, 0, 1},  // horizontal gradient
+    {-1, -1, 1, 1}, // falling diagonal
+    {-1, 0, 1, 0},  // vertical gradient
+    {1, -1, -1, 1}, // rising diagonal
+};
+
+// rows holds the magnitude rows y - 1, y and y + 1
+static bool isLocalMaxInRows(const float *const *rows, int x, int s_0, double t_low)
+{
+    double m_c = rows[1][x];
+    if (m_c < t_low)
+    {
+        return false;
+    }
+    const SectorNeighbors &neighbors = SECTOR_NEIGHBORS[s_0];
+    double m_L = rows[1 + neighbors.row_L][x + neighbors.x_L];
+    double m_R = rows[1 + neighbors.row_R][x + neighbors.x_R];
+    return m_L <= m_c && m_c >= m_R;
+}
+
+bool isLocalMax(const Plane<float> &E_mag, int x, int y, int s_0, double t_low)
+{
+    const float *rows[3] = {E_mag.row(y - 1), E_mag.row(y), E_mag.row(y + 1)};
+    return isLocalMaxInRows(rows, x, s_0, t_low);
+}
+
+// central differences of row y like calculateGradient(), luma holds the padded rows y - 1, y and y + 1
+static void gradientRow(const float *const *luma, float *d_x, float *d_y, float *magnitude, int width)
+{
+    for (int x = 0; x < width; x++)
+    {
+        d_x[x] = 0.5f * (luma[1][x + 2] - luma[1][x]);
+        d_y[x] = 0.5f * (luma[2][x + 1] - luma[0][x + 1]);
+        magnitude[x] = std::sqrt(d_x[x] * d_x[x] + d_y[x] * d_y[x]);
+    }
+}
+
+// slot of row y in a ring of three rows
+static int ringSlot(int y)
+{
+    return ((y % 3) + 3) % 3;
+}
+
+void nonMaximumSuppression(const LumaPlane &blurred, const BorderStrategy &borderStrategy, double t_low, Plane<float> &E_nms)
+{
+    int width = blurred.width();
+    int height = blurred.height();
+    withBorderPolicy(borderStrategy, [&blurred, &E_nms, width, height, t_low](auto border) {
+        // every band keeps the last three luma and gradient rows, rows next to the band are computed twice
+        parallelBands(width, height, [&blurred, &E_nms, &border, width, height, t_low](int begin, int end) {
+            int first = std::max(begin, 1);
+            int last = std::min(end, height - 1);
+            if (first >= last)
+            {
+                return;
+            }
+            std::vector<float> lumaRows(3 * (width + 2));
+            std::vector<float> gradientRows(3 * 3 * width);
+            std::vector<uint8_t> sectors(width);
+            auto luma = [&lumaRows, width](int y) { return lumaRows.data() + ringSlot(y) * (width + 2); };
+            auto d_x = [&gradientRows, width](int y) { return gradientRows.data() + ringSlot(y) * width; };
+            auto d_y = [&gradientRows, width](int y) { return gradientRows.data() + (3 + ringSlot(y)) * width; };
+            auto magnitude = [&gradientRows, width](int y) { return gradientRows.data() + (6 + ringSlot(y)) * width; };
+
+            padRow(blurred, first - 2, 1, 1, border, luma(first - 2));
+            padRow(blurred, first - 1, 1, 1, border, luma(first - 1));
+            for (int y = first - 1; y <= last; y++)
+            {
+                padRow(blurred, y + 1, 1, 1, border, luma(y + 1));
+                const float *lumaAround[3] = {luma(y - 1), luma(y), luma(y + 1)};
+                gradientRow(lumaAround, d_x(y), d_y(y), magnitude(y), width);
+                if (y < first + 1)
+                {
+                    continue;
+                }
+
+                // row y - 1 has all of its neighbors now
+                int y_c = y - 1;
+                const float *magnitudeAround[3] = {magnitude(y_c - 1), magnitude(y_c), magnitude(y_c + 1)};
+                orientationSectors(d_x(y_c), d_y(y_c), sectors.data(), width);
+                float *out = E_nms.row(y_c);
+                for (int x = 1; x < width - 1; x++)
+                {
+                    if (isLocalMaxInRows(magnitudeAround, x, sectors[x], t_low))
+                    {
+                        out[x] = magnitudeAround[1][x];
+                    }
+                }
+            }
+        });
+    });
+}
+
+void traceAndThreshold(const Plane<float> &E_nms, Plane<uint8_t> &E_bin, int x_0, int y_0, double t_low)
+{
+    int M = E_bin.height();
+    int N = E_bin.width();
+
+    // flood fill with an explicit stack, pixels are marked when pushed so each one is pushed once
+    E_bin(x_0, y_0) = true;
+    std::vector<std::pair<int, int>> stack{{x_0, y_0}};
+    while (!stack.empty())
+    {
+        auto [x_c, y_c] = stack.back();
+        stack.pop_back();
+        int x_L = std::max(x_c - 1, 0);
+        int x_R = std::min(x_c + 1, N - 1);
+        int y_L = std::max(y_c - 1, 0);
+        int y_R = std::min(y_c + 1, M - 1);
+        for (int y = y_L; y <= y_R; y++)
+        {
+            for (int x = x_L; x <= x_R; x++)
+            {
+                if (E_nms(x, y) >= t_low && !E_bin(x, y))
+                {
+                    E_bin(x, y) = true;
+                    stack.emplace_back(x, y);
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Parallel hysteresis as connected components: pixels of at least t_low and
+ * the seeds are nodes, 8-neighbors are connected, and a component is an edge
+ * if it holds a seed. Every band of rows is labeled with a union-find on its
+ * own, the roots are the smallest pixel index of their tree. The rows where
+ * bands meet are then united serially and a last parallel pass looks up the
+ * root of every pixel, so the result is the one of traceAndThreshold().
+ */
+
+static const uint32_t NO_LABEL = UINT32_MAX;
+
+static uint32_t findRoot(uint32_t *parent, uint32_t p)
+{
+    while (parent[p] != p)
+    {
+        // path halving
+        parent[p] = parent[parent[p]];
+        p = parent[p];
+    }
+    return p;
+}
+
+// links the larger root below the smaller one and hands its seed flag on, returns the remaining root
+static uint32_t unite(uint32_t *parent, uint8_t *isSeeded, uint32_t p, uint32_t q)
+{
+    uint32_t a = findRoot(parent, p);
+    uint32_t b = findRoot(parent, q);
+    if (a > b)
+    {
+        std::swap(a, b);
+    }
+    if (a != b)
+    {
+        parent[b] = a;
+        isSeeded[a] |= isSeeded[b];
+    }
+    return a;
+}
+
+// hysteresis over value(x, y), the magnitude of the local maxima
+template <typename Value>
+static void labelEdges(int width, int height, double t_low, double t_high, Value &&value, Plane<uint8_t> &E_bin)
+{
+    // every entry is written by the band pass before it is read, so the labels start uninitialized
+    size_t size = (size_t)width * height;
+    std::unique_ptr<uint32_t[]> parentLabels(new uint32_t[size]);
+    std::unique_ptr<uint8_t[]> seededLabels(new uint8_t[size]);
+    std::vector<uint8_t> isBandStart(height, false);
+    uint32_t *parent = parentLabels.get();
+    uint8_t *isSeeded = seededLabels.get();
+
+    parallelBands(width, height, [parent, isSeeded, &isBandStart, &value, width, height, t_low, t_high](int begin, int end) {
+        isBandStart[begin] = true;
+        for (int y = begin; y < end; y++)
+        {
+            bool hasAbove = y > begin;
+            for (int x = 0; x < width; x++)
+            {
+                uint32_t p = (uint32_t)y * width + x;
+                double m = value(x, y);
+                // seeds like the loop over the interior of applyCannyAlgorithm()
+                bool isSeed = x > 0 && x < width - 1 && y > 0 && y < height - 1 && m >= t_high;
+                if (m < t_low && !isSeed)
+                {
+                    parent[p] = NO_LABEL;
+                    continue;
+                }
+                // the pixel above touches the other three neighbors before p, otherwise the left and
+                // upper left pixels touch each other and only the upper right one can join another tree
+                uint32_t above = p - width;
+                uint32_t label = p;
+                if (hasAbove && parent[above] != NO_LABEL)
+                {
+                    label = findRoot(parent, above);
+                }
+                else
+                {
+                    if (x > 0 && parent[p - 1] != NO_LABEL)
+                    {
+                        label = findRoot(parent, p - 1);
+                    }
+                    else if (hasAbove && x > 0 && parent[above - 1] != NO_LABEL)
+                    {
+                        label = findRoot(parent, above - 1);
+                    }
+                    if (hasAbove && x < width - 1 && parent[above + 1] != NO_LABEL)
+                    {
+                        label = label == p ? findRoot(parent, above + 1) : unite(parent, isSeeded, label, above + 1);
+                    }
+                }
+                parent[p] = label;
+                if (label == p)
+                {
+                    isSeeded[p] = isSeed;
+                }
+                else
+                {
+                    isSeeded[label] |= isSeed;
+                }
+            }
+        }
+        // flatten the band, its pixels now point right at their roots
+        for (uint32_t p = (uint32_t)begin * width; p < (uint32_t)end * width; p++)
+        {
+            if (parent[p] != NO_LABEL)
+            {
+                parent[p] = findRoot(parent, p);
+            }
+        }
+    });
+
+    // components across the bands, only the first row of a band has neighbors in the band above
+    for (int y = 1; y < height; y++)
+    {
+        if (!isBandStart[y])
+        {
+            continue;
+        }
+        for (int x = 0; x < width; x++)
+        {
+            uint32_t p = (uint32_t)y * width + x;
+            if (parent[p] == NO_LABEL)
+            {
+                continue;
+            }
+            for (int u = std::max(x - 1, 0); u <= std::min(x + 1, width - 1); u++)
+            {
+                uint32_t q = (uint32_t)(y - 1) * width + u;
+                if (parent[q] != NO_LABEL)
+                {
+                    unite(parent, isSeeded, p, q);
+                }
+            }
+        }
+    }
+
+    // only roots changed since the bands were flattened, so a root chain is at most as long as there are bands
+    parallelRows(E_bin, [parent, isSeeded, width](int y, uint8_t *edges) {
+        for (int x = 0; x < width; x++)
+        {
+            uint32_t p = (uint32_t)y * width + x;
+            if (parent[p] == NO_LABEL)
+            {
+                edges[x] = false;
+                continue;
+            }
+            while (parent[p] != p)
+            {
+                p = parent[p];
+            }
+            edges[x] = isSeeded[p];
+        }
+    });
+}
+
+void hysteresis(const Plane<float> &E_nms, double t_low, double t_high, Plane<uint8_t> &E_bin)
+{
+    labelEdges(E_nms.width(), E_nms.height(), t_low, t_high, [&E_nms](int x, int y) {
+        return E_nms(x, y);
+    }, E_bin);
+}
+
+// the local maxima of the gradient magnitude, nonMaximumSuppression() without a threshold
+static Plane<float> localMaxima(const LumaPlane &source, double sigma, const BorderStrategy &borderStrategy)
+{
+    Plane<float> E_max(source.width(), source.height(), 0);
+    LumaPlane blurred = applyGaussianFilter(sigma, source, borderStrategy);
+    nonMaximumSuppression(blurred, borderStrategy, -std::numeric_limits<double>::infinity(), E_max);
+    return E_max;
+}
+
+// traces the edges over the local maxima of at least t_low, like nonMaximumSuppression() with t_low
+static Image traceEdges(const Plane<float> &E_max, double t_low, double t_high)
+{
+    int width = E_max.width();
+    int height = E_max.height();
+    Plane<uint8_t> E_bin(width, height);
+    labelEdges(width, height, t_low, t_high, [&E_max, t_low](int x, int y) {
+        float magnitude = E_max(x, y);
+        return magnitude >= t_low ? magnitude : 0.0f;
+    }, E_bin);
+    Image target(width, height);
+    parallelTransformPixels(E_bin, target, [](uint8_t edge) {
+        return edge ? rgb(255, 255, 255) : rgb(0, 0, 0);
+    });
+    return target;
+}
+
+Image applyCannyAlgorithm(const LumaPlane &source, double sigma, double t_low, double t_high, const BorderStrategy &borderStrategy)
+{
+    return traceEdges(localMaxima(source, sigma, borderStrategy), t_low, t_high);
+}
+
+Image CannyStages::apply(const LumaPlane &source, uint64_t imageVersion, double sigma, double t_low, double t_high, const BorderStrategy &borderStrategy)
+{
+    // only the builtin strategies can be compared, a custom one is never reused
+    auto border = borderStrategy.target<int (*)(int, int, const LumaPlane &)>();
+    reused = hasStages && border != nullptr && *border == stagesBorder && imageVersion == stagesVersion && sigma == stagesSigma;
+    if (!reused)
+    {
+        // a cancelled blur or suppression throws before the stages and their key change
+        E_max = localMaxima(source, sigma, borderStrategy);
+        hasStages = border != nullptr;
+        stagesBorder = border != nullptr ? *border : nullptr;
+        stagesVersion = imageVersion;
+        stagesSigma = sigma;
+    }
+    return traceEdges(E_max, t_low, t_high);
+}
+
+bool CannyStages::wasReused() const
+{
+    return reused;
+}
+
+void CannyStages::clear()
+{
+    hasStages = false;
+    E_max = Plane<float>();
+}
+
+} // namespace imagecore
@@ -0,0 +1,51 @@
+#ifndef IMAGECORE_CANNY_H
+#define IMAGECORE_CANNY_H
+
+#include <cstdint>
+
+#include "filter.h"
+#include "image.h"
+#include "plane.h"
+
+namespace imagecore
+{
+
+// gradient direction quantized to 0 (horizontal), 1 (falling diagonal), 2 (vertical) or 3 (rising diagonal)
+int getOrientationSector(double &d_x, double &d_y);
+// the same for a row of gradients, vectorized
+void orientationSectors(const float *d_x, const float *d_y, uint8_t *sectors, int width);
+bool isLocalMax(const Plane<float> &E_mag, int x, int y, int s_0, double t_low);
+// gradient, magnitude, orientation sector and isLocalMax() in one sweep over bands of rows, writes the magnitude of
+// the local maxima among the inner pixels to E_nms and leaves the other pixels untouched
+void nonMaximumSuppression(const LumaPlane &blurred, const BorderStrategy &borderStrategy, double t_low, Plane<float> &E_nms);
+// marks the pixel and all pixels of at least t_low connected to it, serially with an explicit stack
+void traceAndThreshold(const Plane<float> &E_nms, Plane<uint8_t> &E_bin, int x, int y, double t_low);
+// E_bin = traceAndThreshold() from every inner pixel of at least t_high, as parallel connected components
+// that need no recursion, for images below 2^32 pixels
+void hysteresis(const Plane<float> &E_nms, double t_low, double t_high, Plane<uint8_t> &E_bin);
+// returns the edges as white pixels on black
+Image applyCannyAlgorithm(const LumaPlane &source, double sigma, double t_low, double t_high, const BorderStrategy &borderStrategy);
+
+// applyCannyAlgorithm() that keeps the local maxima of the last image, sigma and border strategy, so a change of
+// only the thresholds reruns just the hysteresis; imageVersion must change whenever the source does
+class CannyStages
+{
+public:
+    Image apply(const LumaPlane &source, uint64_t imageVersion, double sigma, double t_low, double t_high, const BorderStrategy &borderStrategy);
+    // whether the last apply() skipped the blur and the non-maximum suppression
+    bool wasReused() const;
+    void clear();
+
+private:
+    bool hasStages = false;
+    bool reused = false;
+    uint64_t stagesVersion = 0;
+    double stagesSigma = 0;
+    int (*stagesBorder)(int, int, const LumaPlane &) = nullptr;
+    // gradient magnitude at the local maxima, 0 elsewhere
+    Plane<float> E_max;
+};
+
+} // namespace imagecore
+
+#endif
@@ -0,0 +1,477 @@
+#include "color.h"
+
+#include "cpu.h"
+#include "iterate.h"
+
+#ifdef IMAGECORE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace imagecore
+{
+
+// all coefficients are scaled by 1000, divided by 256 * 1000 afterwards
+static const int DENOMINATOR = 256000;
+
+static const int Y_R = 65738;
+static const int Y_G = 129057;
+static const int Y_B = 25064;
+static const int CB_R = -37945;
+static const int CB_G = -74494;
+static const int CB_B = 112439;
+static const int CR_R = 112439;
+static const int CR_G = -94154;
+static const int CR_B = -18285;
+
+static const int R_Y = 298082;
+static const int R_CR = 408583;
+static const int G_CB = -100291;
+static const int G_CR = -208120;
+static const int B_CB = 516411;
+
+// outside of this range the inverse conversion saturates every channel,
+// clamping the luma first keeps the fixed-point sums inside 32 bit
+static const int LUMA_MIN = -256;
+static const int LUMA_MAX = 511;
+
+int rgbToGray(int red, int green, int blue)
+{
+    return 16 + (Y_R * red + Y_G * green + Y_B * blue) / DENOMINATOR;
+}
+int rgbToGray(Rgb color)
+{
+    return rgbToGray(red(color), green(color), blue(color));
+}
+
+std::tuple<int, int, int> rgbToYCbCr(Rgb color)
+{
+    return rgbToYCbCr(std::tuple<int, int, int>(red(color), green(color), blue(color)));
+}
+std::tuple<int, int, int> rgbToYCbCr(std::tuple<int, int, int> rgb)
+{
+    int red = std::get<0>(rgb);
+    int green = std::get<1>(rgb);
+    int blue = std::get<2>(rgb);
+    return std::tuple<int, int, int>(
+        rgbToGray(red, green, blue),
+        128 + (CB_R * red + CB_G * green + CB_B * blue) / DENOMINATOR,
+        128 + (CR_R * red + CR_G * green + CR_B * blue) / DENOMINATOR);
+}
+Rgb yCbCrToRgb(std::tuple<int, int, int> value)
+{
+    int y = clamp(std::get<0>(value), LUMA_MIN, LUMA_MAX);
+    int cb = std::get<1>(value);
+    int cr = std::get<2>(value);
+    int yComponent = R_Y * (y - 16);
+
+    int r = (yComponent + R_CR * (cr - 128)) / DENOMINATOR;
+    int g = (yComponent + G_CB * (cb - 128) + G_CR * (cr - 128)) / DENOMINATOR;
+    int b = (yComponent + B_CB * (cb - 128)) / DENOMINATOR;
+
+    return rgb(
+        clamp(r, 0, GRAY_SPECTRUM - 1),
+        clamp(g, 0, GRAY_SPECTRUM - 1),
+        clamp(b, 0, GRAY_SPECTRUM - 1));
+}
+Rgb rgbToGrayColor(Rgb color)
+{
+    int value = rgbToGray(red(color), green(color), blue(color));
+    return rgb(value, value, value);
+}
+
+/*
+ * row kernels
+ */
+
+static void rgbToYCbCrRowScalar(const Rgb *in, int16_t *y, uint8_t *cb, uint8_t *cr, int width)
+{
+    for (int x = 0; x < width; x++)
+    {
+        int r = red(in[x]);
+        int g = green(in[x]);
+        int b = blue(in[x]);
+        y[x] = rgbToGray(r, g, b);
+        if (cb != nullptr)
+        {
+            cb[x] = 128 + (CB_R * r + CB_G * g + CB_B * b) / DENOMINATOR;
+            cr[x] = 128 + (CR_R * r + CR_G * g + CR_B * b) / DENOMINATOR;
+        }
+    }
+}
+
+static void yCbCrToRgbRowScalar(const int16_t *y, const uint8_t *cb, const uint8_t *cr, Rgb *out, int width)
+{
+    for (int x = 0; x < width; x++)
+    {
+        out[x] = yCbCrToRgb(std::tuple<int, int, int>(y[x], cb[x], cr[x]));
+    }
+}
+
+#ifdef IMAGECORE_X86_SIMD
+
+/*
+ * The vector kernels multiply 16 bit pairs with pmaddwd, so the 17-20 bit
+ * coefficients are split into a high part (c / 4 resp. c / 16) and a low
+ * remainder. The division by 256000 is a shift by 11 followed by an exact
+ * reciprocal multiplication for the remaining factor 125:
+ * floor(q / 125) == (q * 33555) >> 22 for all 0 <= q < 2^15.
+ */
+static const int FORWARD_SPLIT = 2;
+static const int INVERSE_SPLIT = 4;
+static const short RECIPROCAL_125 = (short)33555;
+
+static inline short high(int coefficient, int split)
+{
+    return coefficient / (1 << split);
+}
+static inline short low(int coefficient, int split)
+{
+    return coefficient - high(coefficient, split) * (1 << split);
+}
+
+// coefficients for pixels unpacked to the 16 bit lanes b, g, r, a
+static inline __m128i sse2PixelCoefficients(short r, short g, short b)
+{
+    return _mm_set_epi16(0, r, g, b, 0, r, g, b);
+}
+
+// weighted channel sum of pixels 0, 1 (lo) and 2, 3 (hi)
+static inline __m128i sse2ChannelSum(__m128i lo, __m128i hi, __m128i coefficientsHigh, __m128i coefficientsLow)
+{
+    __m128i a = _mm_add_epi32(_mm_slli_epi32(_mm_madd_epi16(lo, coefficientsHigh), FORWARD_SPLIT), _mm_madd_epi16(lo, coefficientsLow));
+    __m128i b = _mm_add_epi32(_mm_slli_epi32(_mm_madd_epi16(hi, coefficientsHigh), FORWARD_SPLIT), _mm_madd_epi16(hi, coefficientsLow));
+    __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(3, 1, 3, 1));
+    return _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+}
+
+// s / 256000 truncated towards zero for |s| < 2^26, packed to 16 bit
+static inline __m128i sse2Divide(__m128i s0, __m128i s1)
+{
+    __m128i sign0 = _mm_srai_epi32(s0, 31);
+    __m128i sign1 = _mm_srai_epi32(s1, 31);
+    __m128i q0 = _mm_srli_epi32(_mm_sub_epi32(_mm_xor_si128(s0, sign0), sign0), 11);
+    __m128i q1 = _mm_srli_epi32(_mm_sub_epi32(_mm_xor_si128(s1, sign1), sign1), 11);
+    __m128i sign = _mm_packs_epi32(sign0, sign1);
+    __m128i d = _mm_srli_epi16(_mm_mulhi_epu16(_mm_packs_epi32(q0, q1), _mm_set1_epi16(RECIPROCAL_125)), 6);
+    return _mm_sub_epi16(_mm_xor_si128(d, sign), sign);
+}
+
+// clamp(s / 256000, 0, 255) packed to 16 bit
+static inline __m128i sse2DivideClamp(__m128i s0, __m128i s1)
+{
+    s0 = _mm_andnot_si128(_mm_srai_epi32(s0, 31), s0);
+    s1 = _mm_andnot_si128(_mm_srai_epi32(s1, 31), s1);
+    // the signed pack saturates large sums to 32767, which still divides to more than 255
+    __m128i q = _mm_packs_epi32(_mm_srli_epi32(s0, 11), _mm_srli_epi32(s1, 11));
+    __m128i d = _mm_srli_epi16(_mm_mulhi_epu16(q, _mm_set1_epi16(RECIPROCAL_125)), 6);
+    return _mm_min_epi16(d, _mm_set1_epi16(255));
+}
+
+// weighted sum of interleaved 16 bit pairs
+static inline __m128i sse2PairSum(__m128i pairs, __m128i coefficientsHigh, __m128i coefficientsLow)
+{
+    return _mm_add_epi32(_mm_slli_epi32(_mm_madd_epi16(pairs, coefficientsHigh), INVERSE_SPLIT), _mm_madd_epi16(pairs, coefficientsLow));
+}
+
+static inline __m128i sse2Pair(short a, short b)
+{
+    return _mm_set_epi16(b, a, b, a, b, a, b, a);
+}
+
+static void rgbToYCbCrRowSSE2(const Rgb *in, int16_t *y, uint8_t *cb, uint8_t *cr, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i yHigh = sse2PixelCoefficients(high(Y_R, FORWARD_SPLIT), high(Y_G, FORWARD_SPLIT), high(Y_B, FORWARD_SPLIT));
+    const __m128i yLow = sse2PixelCoefficients(low(Y_R, FORWARD_SPLIT), low(Y_G, FORWARD_SPLIT), low(Y_B, FORWARD_SPLIT));
+    const __m128i cbHigh = sse2PixelCoefficients(high(CB_R, FORWARD_SPLIT), high(CB_G, FORWARD_SPLIT), high(CB_B, FORWARD_SPLIT));
+    const __m128i cbLow = sse2PixelCoefficients(low(CB_R, FORWARD_SPLIT), low(CB_G, FORWARD_SPLIT), low(CB_B, FORWARD_SPLIT));
+    const __m128i crHigh = sse2PixelCoefficients(high(CR_R, FORWARD_SPLIT), high(CR_G, FORWARD_SPLIT), high(CR_B, FORWARD_SPLIT));
+    const __m128i crLow = sse2PixelCoefficients(low(CR_R, FORWARD_SPLIT), low(CR_G, FORWARD_SPLIT), low(CR_B, FORWARD_SPLIT));
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + x));
+        __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + x + 4));
+        __m128i p0lo = _mm_unpacklo_epi8(p0, zero);
+        __m128i p0hi = _mm_unpackhi_epi8(p0, zero);
+        __m128i p1lo = _mm_unpacklo_epi8(p1, zero);
+        __m128i p1hi = _mm_unpackhi_epi8(p1, zero);
+
+        __m128i luma = sse2Divide(sse2ChannelSum(p0lo, p0hi, yHigh, yLow), sse2ChannelSum(p1lo, p1hi, yHigh, yLow));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(y + x), _mm_add_epi16(luma, _mm_set1_epi16(16)));
+        if (cb != nullptr)
+        {
+            __m128i blue = sse2Divide(sse2ChannelSum(p0lo, p0hi, cbHigh, cbLow), sse2ChannelSum(p1lo, p1hi, cbHigh, cbLow));
+            __m128i red = sse2Divide(sse2ChannelSum(p0lo, p0hi, crHigh, crLow), sse2ChannelSum(p1lo, p1hi, crHigh, crLow));
+            blue = _mm_add_epi16(blue, _mm_set1_epi16(128));
+            red = _mm_add_epi16(red, _mm_set1_epi16(128));
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(cb + x), _mm_packus_epi16(blue, blue));
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(cr + x), _mm_packus_epi16(red, red));
+        }
+    }
+    rgbToYCbCrRowScalar(in + x, y + x, cb == nullptr ? nullptr : cb + x, cr == nullptr ? nullptr : cr + x, width - x);
+}
+
+static void yCbCrToRgbRowSSE2(const int16_t *y, const uint8_t *cb, const uint8_t *cr, Rgb *out, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rHigh = sse2Pair(high(R_Y, INVERSE_SPLIT), high(R_CR, INVERSE_SPLIT));
+    const __m128i rLow = sse2Pair(low(R_Y, INVERSE_SPLIT), low(R_CR, INVERSE_SPLIT));
+    const __m128i gHigh = sse2Pair(high(R_Y, INVERSE_SPLIT), high(G_CB, INVERSE_SPLIT));
+    const __m128i gLow = sse2Pair(low(R_Y, INVERSE_SPLIT), low(G_CB, INVERSE_SPLIT));
+    const __m128i gCrHigh = sse2Pair(high(G_CR, INVERSE_SPLIT), 0);
+    const __m128i gCrLow = sse2Pair(low(G_CR, INVERSE_SPLIT), 0);
+    const __m128i bHigh = sse2Pair(high(R_Y, INVERSE_SPLIT), high(B_CB, INVERSE_SPLIT));
+    const __m128i bLow = sse2Pair(low(R_Y, INVERSE_SPLIT), low(B_CB, INVERSE_SPLIT));
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i luma = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+        luma = _mm_min_epi16(_mm_max_epi16(luma, _mm_set1_epi16(LUMA_MIN)), _mm_set1_epi16(LUMA_MAX));
+        luma = _mm_sub_epi16(luma, _mm_set1_epi16(16));
+        __m128i blue = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(cb + x)), zero), _mm_set1_epi16(128));
+        __m128i red = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(cr + x)), zero), _mm_set1_epi16(128));
+
+        __m128i lumaRedLo = _mm_unpacklo_epi16(luma, red);
+        __m128i lumaRedHi = _mm_unpackhi_epi16(luma, red);
+        __m128i lumaBlueLo = _mm_unpacklo_epi16(luma, blue);
+        __m128i lumaBlueHi = _mm_unpackhi_epi16(luma, blue);
+        __m128i redLo = _mm_unpacklo_epi16(red, zero);
+        __m128i redHi = _mm_unpackhi_epi16(red, zero);
+
+        __m128i r = sse2DivideClamp(sse2PairSum(lumaRedLo, rHigh, rLow), sse2PairSum(lumaRedHi, rHigh, rLow));
+        __m128i g = sse2DivideClamp(_mm_add_epi32(sse2PairSum(lumaBlueLo, gHigh, gLow), sse2PairSum(redLo, gCrHigh, gCrLow)),
+                                    _mm_add_epi32(sse2PairSum(lumaBlueHi, gHigh, gLow), sse2PairSum(redHi, gCrHigh, gCrLow)));
+        __m128i b = sse2DivideClamp(sse2PairSum(lumaBlueLo, bHigh, bLow), sse2PairSum(lumaBlueHi, bHigh, bLow));
+
+        // 16 bit lanes 0xGGBB and 0xFFRR interleave to 0xFFRRGGBB
+        __m128i blueGreen = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+        __m128i redAlpha = _mm_or_si128(r, _mm_set1_epi16((short)0xff00));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_unpacklo_epi16(blueGreen, redAlpha));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x + 4), _mm_unpackhi_epi16(blueGreen, redAlpha));
+    }
+    yCbCrToRgbRowScalar(y + x, cb + x, cr + x, out + x, width - x);
+}
+
+/*
+ * AVX2 versions of the kernels above. Packs and unpacks work within each
+ * 128 bit lane, the permutes restore the pixel order where needed.
+ */
+
+IMAGECORE_TARGET_AVX2 static inline __m256i avx2PixelCoefficients(short r, short g, short b)
+{
+    return _mm256_set_epi16(0, r, g, b, 0, r, g, b, 0, r, g, b, 0, r, g, b);
+}
+
+// weighted channel sum of 8 pixels in pixel order
+IMAGECORE_TARGET_AVX2 static inline __m256i avx2ChannelSum(__m256i lo, __m256i hi, __m256i coefficientsHigh, __m256i coefficientsLow)
+{
+    __m256i a = _mm256_add_epi32(_mm256_slli_epi32(_mm256_madd_epi16(lo, coefficientsHigh), FORWARD_SPLIT), _mm256_madd_epi16(lo, coefficientsLow));
+    __m256i b = _mm256_add_epi32(_mm256_slli_epi32(_mm256_madd_epi16(hi, coefficientsHigh), FORWARD_SPLIT), _mm256_madd_epi16(hi, coefficientsLow));
+    __m256 even = _mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(2, 0, 2, 0));
+    __m256 odd = _mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(3, 1, 3, 1));
+    return _mm256_add_epi32(_mm256_castps_si256(even), _mm256_castps_si256(odd));
+}
+
+// s / 256000 truncated towards zero for 16 pixels, packed to 16 bit in pixel order
+IMAGECORE_TARGET_AVX2 static inline __m256i avx2Divide(__m256i s0, __m256i s1)
+{
+    __m256i sign0 = _mm256_srai_epi32(s0, 31);
+    __m256i sign1 = _mm256_srai_epi32(s1, 31);
+    __m256i q0 = _mm256_srli_epi32(_mm256_sub_epi32(_mm256_xor_si256(s0, sign0), sign0), 11);
+    __m256i q1 = _mm256_srli_epi32(_mm256_sub_epi32(_mm256_xor_si256(s1, sign1), sign1), 11);
+    __m256i sign = _mm256_packs_epi32(sign0, sign1);
+    __m256i d = _mm256_srli_epi16(_mm256_mulhi_epu16(_mm256_packs_epi32(q0, q1), _mm256_set1_epi16(RECIPROCAL_125)), 6);
+    return _mm256_permute4x64_epi64(_mm256_sub_epi16(_mm256_xor_si256(d, sign), sign), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+IMAGECORE_TARGET_AVX2 static inline __m256i avx2DivideClamp(__m256i s0, __m256i s1)
+{
+    s0 = _mm256_andnot_si256(_mm256_srai_epi32(s0, 31), s0);
+    s1 = _mm256_andnot_si256(_mm256_srai_epi32(s1, 31), s1);
+    __m256i q = _mm256_packs_epi32(_mm256_srli_epi32(s0, 11), _mm256_srli_epi32(s1, 11));
+    __m256i d = _mm256_srli_epi16(_mm256_mulhi_epu16(q, _mm256_set1_epi16(RECIPROCAL_125)), 6);
+    return _mm256_min_epi16(d, _mm256_set1_epi16(255));
+}
+
+IMAGECORE_TARGET_AVX2 static inline __m256i avx2PairSum(__m256i pairs, __m256i coefficientsHigh, __m256i coefficientsLow)
+{
+    return _mm256_add_epi32(_mm256_slli_epi32(_mm256_madd_epi16(pairs, coefficientsHigh), INVERSE_SPLIT), _mm256_madd_epi16(pairs, coefficientsLow));
+}
+
+IMAGECORE_TARGET_AVX2 static inline __m256i avx2Pair(short a, short b)
+{
+    return _mm256_set_epi16(b, a, b, a, b, a, b, a, b, a, b, a, b, a, b, a);
+}
+
+// 16 bit values of 16 pixels to 16 bytes in pixel order
+IMAGECORE_TARGET_AVX2 static inline __m128i avx2PackBytes(__m256i values)
+{
+    return _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi16(values, values), _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+IMAGECORE_TARGET_AVX2 static void rgbToYCbCrRowAVX2(const Rgb *in, int16_t *y, uint8_t *cb, uint8_t *cr, int width)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i yHigh = avx2PixelCoefficients(high(Y_R, FORWARD_SPLIT), high(Y_G, FORWARD_SPLIT), high(Y_B, FORWARD_SPLIT));
+    const __m256i yLow = avx2PixelCoefficients(low(Y_R, FORWARD_SPLIT), low(Y_G, FORWARD_SPLIT), low(Y_B, FORWARD_SPLIT));
+    const __m256i cbHigh = avx2PixelCoefficients(high(CB_R, FORWARD_SPLIT), high(CB_G, FORWARD_SPLIT), high(CB_B, FORWARD_SPLIT));
+    const __m256i cbLow = avx2PixelCoefficients(low(CB_R, FORWARD_SPLIT), low(CB_G, FORWARD_SPLIT), low(CB_B, FORWARD_SPLIT));
+    const __m256i crHigh = avx2PixelCoefficients(high(CR_R, FORWARD_SPLIT), high(CR_G, FORWARD_SPLIT), high(CR_B, FORWARD_SPLIT));
+    const __m256i crLow = avx2PixelCoefficients(low(CR_R, FORWARD_SPLIT), low(CR_G, FORWARD_SPLIT), low(CR_B, FORWARD_SPLIT));
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i p0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + x));
+        __m256i p1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + x + 8));
+        __m256i p0lo = _mm256_unpacklo_epi8(p0, zero);
+        __m256i p0hi = _mm256_unpackhi_epi8(p0, zero);
+        __m256i p1lo = _mm256_unpacklo_epi8(p1, zero);
+        __m256i p1hi = _mm256_unpackhi_epi8(p1, zero);
+
+        __m256i luma = avx2Divide(avx2ChannelSum(p0lo, p0hi, yHigh, yLow), avx2ChannelSum(p1lo, p1hi, yHigh, yLow));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(y + x), _mm256_add_epi16(luma, _mm256_set1_epi16(16)));
+        if (cb != nullptr)
+        {
+            __m256i blue = avx2Divide(avx2ChannelSum(p0lo, p0hi, cbHigh, cbLow), avx2ChannelSum(p1lo, p1hi, cbHigh, cbLow));
+            __m256i red = avx2Divide(avx2ChannelSum(p0lo, p0hi, crHigh, crLow), avx2ChannelSum(p1lo, p1hi, crHigh, crLow));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(cb + x), avx2PackBytes(_mm256_add_epi16(blue, _mm256_set1_epi16(128))));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(cr + x), avx2PackBytes(_mm256_add_epi16(red, _mm256_set1_epi16(128))));
+        }
+    }
+    rgbToYCbCrRowSSE2(in + x, y + x, cb == nullptr ? nullptr : cb + x, cr == nullptr ? nullptr : cr + x, width - x);
+}
+
+IMAGECORE_TARGET_AVX2 static void yCbCrToRgbRowAVX2(const int16_t *y, const uint8_t *cb, const uint8_t *cr, Rgb *out, int width)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i rHigh = avx2Pair(high(R_Y, INVERSE_SPLIT), high(R_CR, INVERSE_SPLIT));
+    const __m256i rLow = avx2Pair(low(R_Y, INVERSE_SPLIT), low(R_CR, INVERSE_SPLIT));
+    const __m256i gHigh = avx2Pair(high(R_Y, INVERSE_SPLIT), high(G_CB, INVERSE_SPLIT));
+    const __m256i gLow = avx2Pair(low(R_Y, INVERSE_SPLIT), low(G_CB, INVERSE_SPLIT));
+    const __m256i gCrHigh = avx2Pair(high(G_CR, INVERSE_SPLIT), 0);
+    const __m256i gCrLow = avx2Pair(low(G_CR, INVERSE_SPLIT), 0);
+    const __m256i bHigh = avx2Pair(high(R_Y, INVERSE_SPLIT), high(B_CB, INVERSE_SPLIT));
+    const __m256i bLow = avx2Pair(low(R_Y, INVERSE_SPLIT), low(B_CB, INVERSE_SPLIT));
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i luma = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(y + x));
+        luma = _mm256_min_epi16(_mm256_max_epi16(luma, _mm256_set1_epi16(LUMA_MIN)), _mm256_set1_epi16(LUMA_MAX));
+        luma = _mm256_sub_epi16(luma, _mm256_set1_epi16(16));
+        __m256i blue = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(cb + x))), _mm256_set1_epi16(128));
+        __m256i red = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(cr + x))), _mm256_set1_epi16(128));
+
+        __m256i lumaRedLo = _mm256_unpacklo_epi16(luma, red);
+        __m256i lumaRedHi = _mm256_unpackhi_epi16(luma, red);
+        __m256i lumaBlueLo = _mm256_unpacklo_epi16(luma, blue);
+        __m256i lumaBlueHi = _mm256_unpackhi_epi16(luma, blue);
+        __m256i redLo = _mm256_unpacklo_epi16(red, zero);
+        __m256i redHi = _mm256_unpackhi_epi16(red, zero);
+
+        __m256i r = avx2DivideClamp(avx2PairSum(lumaRedLo, rHigh, rLow), avx2PairSum(lumaRedHi, rHigh, rLow));
+        __m256i g = avx2DivideClamp(_mm256_add_epi32(avx2PairSum(lumaBlueLo, gHigh, gLow), avx2PairSum(redLo, gCrHigh, gCrLow)),
+                                    _mm256_add_epi32(avx2PairSum(lumaBlueHi, gHigh, gLow), avx2PairSum(redHi, gCrHigh, gCrLow)));
+        __m256i b = avx2DivideClamp(avx2PairSum(lumaBlueLo, bHigh, bLow), avx2PairSum(lumaBlueHi, bHigh, bLow));
+
+        __m256i blueGreen = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+        __m256i redAlpha = _mm256_or_si256(r, _mm256_set1_epi16((short)0xff00));
+        __m256i lo = _mm256_unpacklo_epi16(blueGreen, redAlpha);
+        __m256i hi = _mm256_unpackhi_epi16(blueGreen, redAlpha);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    yCbCrToRgbRowSSE2(y + x, cb + x, cr + x, out + x, width - x);
+}
+
+#endif
+
+void rgbToYCbCrRow(const Rgb *in, int16_t *y, uint8_t *cb, uint8_t *cr, int width)
+{
+    switch (simdLevel())
+    {
+#ifdef IMAGECORE_X86_SIMD
+    case SimdLevel::AVX2:
+        rgbToYCbCrRowAVX2(in, y, cb, cr, width);
+        break;
+    case SimdLevel::SSE2:
+        rgbToYCbCrRowSSE2(in, y, cb, cr, width);
+        break;
+#endif
+    default:
+        rgbToYCbCrRowScalar(in, y, cb, cr, width);
+    }
+}
+
+void yCbCrToRgbRow(const int16_t *y, const uint8_t *cb, const uint8_t *cr, Rgb *out, int width)
+{
+    switch (simdLevel())
+    {
+#ifdef IMAGECORE_X86_SIMD
+    case SimdLevel::AVX2:
+        yCbCrToRgbRowAVX2(y, cb, cr, out, width);
+        break;
+    case SimdLevel::SSE2:
+        yCbCrToRgbRowSSE2(y, cb, cr, out, width);
+        break;
+#endif
+    default:
+        yCbCrToRgbRowScalar(y, cb, cr, out, width);
+    }
+}
+
+void rgbToYCbCr(const Image &source, LumaPlane &y, Plane<uint8_t> &cb, Plane<uint8_t> &cr)
+{
+    int width = source.width();
+    parallelRows(source, y, [&cb, &cr, width](int row, const Rgb *in, int16_t *luma) {
+        rgbToYCbCrRow(in, luma, cb.row(row), cr.row(row), width);
+    });
+}
+
+void rgbToGray(const Image &source, LumaPlane &gray)
+{
+    int width = source.width();
+    parallelRows(source, gray, [width](int, const Rgb *in, int16_t *luma) {
+        rgbToYCbCrRow(in, luma, nullptr, nullptr, width);
+    });
+}
+
+void yCbCrToRgb(const LumaPlane &y, const Plane<uint8_t> &cb, const Plane<uint8_t> &cr, Image &target)
+{
+    int width = y.width();
+    parallelRows(y, target, [&cb, &cr, width](int row, const int16_t *luma, Rgb *out) {
+        yCbCrToRgbRow(luma, cb.row(row), cr.row(row), out, width);
+    });
+}
+
+YCbCrImage toYCbCr(const Image &source)
+{
+    YCbCrImage result{LumaPlane(source.width(), source.height()),
+                      Plane<uint8_t>(source.width(), source.height()),
+                      Plane<uint8_t>(source.width(), source.height())};
+    rgbToYCbCr(source, result.y, result.cb, result.cr);
+    return result;
+}
+
+Image toRgb(const LumaPlane &luma, const YCbCrImage &image)
+{
+    Image target(luma.width(), luma.height());
+    yCbCrToRgb(luma, image.cb, image.cr, target);
+    return target;
+}
+
+Image grayToRgb(const Plane<int16_t> &gray)
+{
+    Image target(gray.width(), gray.height());
+    parallelTransformPixels(gray, target, [](int16_t value) {
+        return rgb(value, value, value);
+    });
+    return target;
+}
+
+} // namespace imagecore
@@ -0,0 +1,73 @@
+#ifndef IMAGECORE_COLOR_H
+#define IMAGECORE_COLOR_H
+
+#include <cstdint>
+#include <limits>
+#include <tuple>
+
+#include "image.h"
+#include "plane.h"
+
+/*
+ * RGB <-> YCbCr (BT.601, studio swing). The coefficients are exact
+ * thousandths, so every conversion is done in integer fixed-point with the
+ * common denominator 256000 and truncates towards zero.
+ */
+
+namespace imagecore
+{
+
+int rgbToGray(int red, int green, int blue);
+int rgbToGray(Rgb color);
+Rgb rgbToGrayColor(Rgb color);
+std::tuple<int, int, int> rgbToYCbCr(std::tuple<int, int, int> rgb);
+std::tuple<int, int, int> rgbToYCbCr(Rgb rgb);
+Rgb yCbCrToRgb(std::tuple<int, int, int> val);
+inline int clamp(int value, int min, int max)
+{
+    if (value < min)
+    {
+        return min;
+    }
+    if (value > max)
+    {
+        return max;
+    }
+    return value;
+}
+
+// batch conversions of whole rows, vectorized with SSE2/AVX2 when available
+// cb and cr may be null if only the luma is needed
+void rgbToYCbCrRow(const Rgb *in, int16_t *y, uint8_t *cb, uint8_t *cr, int width);
+void yCbCrToRgbRow(const int16_t *y, const uint8_t *cb, const uint8_t *cr, Rgb *out, int width);
+
+typedef Plane<int16_t> LumaPlane;
+
+// planar YCbCr of an image, luma operations edit y and keep the chroma
+struct YCbCrImage
+{
+    LumaPlane y;
+    Plane<uint8_t> cb;
+    Plane<uint8_t> cr;
+};
+
+// batch conversions of whole images, all planes need the size of the image
+void rgbToYCbCr(const Image &source, LumaPlane &y, Plane<uint8_t> &cb, Plane<uint8_t> &cr);
+void rgbToGray(const Image &source, LumaPlane &gray);
+void yCbCrToRgb(const LumaPlane &y, const Plane<uint8_t> &cb, const Plane<uint8_t> &cr, Image &target);
+
+YCbCrImage toYCbCr(const Image &source);
+// combines a luma plane with the chroma of image
+Image toRgb(const LumaPlane &luma, const YCbCrImage &image);
+// shows intensities 0..255 as gray pixels
+Image grayToRgb(const Plane<int16_t> &gray);
+
+// saturates an edited intensity to the luma storage, the conversion back clamps it anyway
+inline int16_t toLuma(int value)
+{
+    return clamp(value, std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max());
+}
+
+} // namespace imagecore
+
+#endif
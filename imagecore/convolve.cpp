@@ -0,0 +1,417 @@
+#include "convolve.h"
+
+#include <type_traits>
+
+#include "cpu.h"
+
+#ifdef IMAGECORE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace imagecore
+{
+
+/*
+ * Every kernel is a template on the tap counts. A count above 0 is fixed at
+ * compile time so the tap loops unroll and the weights stay in registers,
+ * 0 takes the count from the arguments.
+ */
+
+template <int N>
+using Taps = std::integral_constant<int, N>;
+
+// calls func with the instantiation for taps taps
+template <typename Func>
+static void withTaps(int taps, Func &&func)
+{
+    switch (taps)
+    {
+    case 3:
+        func(Taps<3>());
+        break;
+    case 5:
+        func(Taps<5>());
+        break;
+    case 7:
+        func(Taps<7>());
+        break;
+    default:
+        func(Taps<0>());
+    }
+}
+
+// 1D kernels read rows[i * (1 - STEP)][x + i * STEP], STEP 1 walks along one row (horizontal pass)
+// and STEP 0 reads the same x of consecutive rows (vertical pass), the rows hold float or double
+template <int TAPS, int STEP, typename T>
+static void convolveScalar(const T *const *rows, const double *weights, int taps, double *out, int width, int offset)
+{
+    taps = TAPS > 0 ? TAPS : taps;
+    for (int x = offset; x < width; x++)
+    {
+        double sum = 0;
+        for (int i = 0; i < taps; i++)
+        {
+            sum += weights[i] * rows[i * (1 - STEP)][x + i * STEP];
+        }
+        out[x] = sum;
+    }
+}
+
+template <int ROWS, int COLS>
+static void convolve2DScalar(const float *const *rows, const double *weights, int kernelRows, int cols, double *out, int width, int offset)
+{
+    kernelRows = ROWS > 0 ? ROWS : kernelRows;
+    cols = COLS > 0 ? COLS : cols;
+    for (int x = offset; x < width; x++)
+    {
+        double sum = 0;
+        for (int v = 0; v < kernelRows; v++)
+        {
+            for (int u = 0; u < cols; u++)
+            {
+                sum += weights[v * cols + u] * rows[v][x + u];
+            }
+        }
+        out[x] = sum;
+    }
+}
+
+template <int ROWS, int COLS>
+static void convolve2DIntScalar(const int16_t *const *rows, const int16_t *weights, int kernelRows, int cols, int32_t *out, int width, int offset)
+{
+    kernelRows = ROWS > 0 ? ROWS : kernelRows;
+    cols = COLS > 0 ? COLS : cols;
+    for (int x = offset; x < width; x++)
+    {
+        int32_t sum = 0;
+        for (int v = 0; v < kernelRows; v++)
+        {
+            for (int u = 0; u < cols; u++)
+            {
+                sum += weights[v * cols + u] * rows[v][x + u];
+            }
+        }
+        out[x] = sum;
+    }
+}
+
+static void recursiveStepScalar(const float *in, const float *const *previous, const float *weights, float *out, int width, int offset)
+{
+    for (int x = offset; x < width; x++)
+    {
+        out[x] = weights[0] * in[x] + weights[1] * previous[0][x] + weights[2] * previous[1][x] + weights[3] * previous[2][x];
+    }
+}
+
+#ifdef IMAGECORE_X86_SIMD
+
+// two accumulators per iteration hide the latency of the dependent adds
+
+static inline __m128d loadSSE2(const float *in)
+{
+    return _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i *)in)));
+}
+
+static inline __m128d loadSSE2(const double *in)
+{
+    return _mm_loadu_pd(in);
+}
+
+IMAGECORE_TARGET_AVX2 static inline __m256d loadAVX2(const float *in)
+{
+    return _mm256_cvtps_pd(_mm_loadu_ps(in));
+}
+
+IMAGECORE_TARGET_AVX2 static inline __m256d loadAVX2(const double *in)
+{
+    return _mm256_loadu_pd(in);
+}
+
+template <int TAPS, int STEP, typename T>
+static void convolveSSE2(const T *const *rows, const double *weights, int taps, double *out, int width)
+{
+    taps = TAPS > 0 ? TAPS : taps;
+    int x = 0;
+    for (; x + 4 <= width; x += 4)
+    {
+        __m128d sum0 = _mm_setzero_pd();
+        __m128d sum1 = _mm_setzero_pd();
+        for (int i = 0; i < taps; i++)
+        {
+            const T *in = rows[i * (1 - STEP)] + x + i * STEP;
+            __m128d weight = _mm_set1_pd(weights[i]);
+            sum0 = _mm_add_pd(sum0, _mm_mul_pd(weight, loadSSE2(in)));
+            sum1 = _mm_add_pd(sum1, _mm_mul_pd(weight, loadSSE2(in + 2)));
+        }
+        _mm_storeu_pd(out + x, sum0);
+        _mm_storeu_pd(out + x + 2, sum1);
+    }
+    convolveScalar<TAPS, STEP>(rows, weights, taps, out, width, x);
+}
+
+template <int ROWS, int COLS>
+static void convolve2DSSE2(const float *const *rows, const double *weights, int kernelRows, int cols, double *out, int width)
+{
+    kernelRows = ROWS > 0 ? ROWS : kernelRows;
+    cols = COLS > 0 ? COLS : cols;
+    int x = 0;
+    for (; x + 4 <= width; x += 4)
+    {
+        __m128d sum0 = _mm_setzero_pd();
+        __m128d sum1 = _mm_setzero_pd();
+        for (int v = 0; v < kernelRows; v++)
+        {
+            for (int u = 0; u < cols; u++)
+            {
+                const float *in = rows[v] + x + u;
+                __m128d weight = _mm_set1_pd(weights[v * cols + u]);
+                sum0 = _mm_add_pd(sum0, _mm_mul_pd(weight, loadSSE2(in)));
+                sum1 = _mm_add_pd(sum1, _mm_mul_pd(weight, loadSSE2(in + 2)));
+            }
+        }
+        _mm_storeu_pd(out + x, sum0);
+        _mm_storeu_pd(out + x + 2, sum1);
+    }
+    convolve2DScalar<ROWS, COLS>(rows, weights, kernelRows, cols, out, width, x);
+}
+
+template <int TAPS, int STEP, typename T>
+IMAGECORE_TARGET_AVX2 static void convolveAVX2(const T *const *rows, const double *weights, int taps, double *out, int width)
+{
+    taps = TAPS > 0 ? TAPS : taps;
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m256d sum0 = _mm256_setzero_pd();
+        __m256d sum1 = _mm256_setzero_pd();
+        for (int i = 0; i < taps; i++)
+        {
+            const T *in = rows[i * (1 - STEP)] + x + i * STEP;
+            __m256d weight = _mm256_set1_pd(weights[i]);
+            sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(weight, loadAVX2(in)));
+            sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(weight, loadAVX2(in + 4)));
+        }
+        _mm256_storeu_pd(out + x, sum0);
+        _mm256_storeu_pd(out + x + 4, sum1);
+    }
+    convolveScalar<TAPS, STEP>(rows, weights, taps, out, width, x);
+}
+
+template <int ROWS, int COLS>
+IMAGECORE_TARGET_AVX2 static void convolve2DAVX2(const float *const *rows, const double *weights, int kernelRows, int cols, double *out, int width)
+{
+    kernelRows = ROWS > 0 ? ROWS : kernelRows;
+    cols = COLS > 0 ? COLS : cols;
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m256d sum0 = _mm256_setzero_pd();
+        __m256d sum1 = _mm256_setzero_pd();
+        for (int v = 0; v < kernelRows; v++)
+        {
+            for (int u = 0; u < cols; u++)
+            {
+                const float *in = rows[v] + x + u;
+                __m256d weight = _mm256_set1_pd(weights[v * cols + u]);
+                sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(weight, loadAVX2(in)));
+                sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(weight, loadAVX2(in + 4)));
+            }
+        }
+        _mm256_storeu_pd(out + x, sum0);
+        _mm256_storeu_pd(out + x + 4, sum1);
+    }
+    convolve2DScalar<ROWS, COLS>(rows, weights, kernelRows, cols, out, width, x);
+}
+
+// pmaddwd weight of the taps u and u + 1 of a kernel row, the low half multiplies the first tap
+static inline int32_t tapPair(const int16_t *weights, int u, int cols)
+{
+    uint32_t high = u + 1 < cols ? (uint16_t)weights[u + 1] : 0;
+    return (int32_t)((high << 16) | (uint16_t)weights[u]);
+}
+
+// interleaving in[x + u] with in[x + u + 1] lets pmaddwd sum two taps of four pixels at once,
+// the last odd tap is paired with zeros
+template <int ROWS, int COLS>
+static void convolve2DIntSSE2(const int16_t *const *rows, const int16_t *weights, int kernelRows, int cols, int32_t *out, int width)
+{
+    kernelRows = ROWS > 0 ? ROWS : kernelRows;
+    cols = COLS > 0 ? COLS : cols;
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i sum0 = _mm_setzero_si128();
+        __m128i sum1 = _mm_setzero_si128();
+        for (int v = 0; v < kernelRows; v++)
+        {
+            const int16_t *in = rows[v] + x;
+            for (int u = 0; u < cols; u += 2)
+            {
+                __m128i first = _mm_loadu_si128((const __m128i *)(in + u));
+                __m128i second = u + 1 < cols ? _mm_loadu_si128((const __m128i *)(in + u + 1)) : _mm_setzero_si128();
+                __m128i weight = _mm_set1_epi32(tapPair(weights + v * cols, u, cols));
+                sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(_mm_unpacklo_epi16(first, second), weight));
+                sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(_mm_unpackhi_epi16(first, second), weight));
+            }
+        }
+        _mm_storeu_si128((__m128i *)(out + x), sum0);
+        _mm_storeu_si128((__m128i *)(out + x + 4), sum1);
+    }
+    convolve2DIntScalar<ROWS, COLS>(rows, weights, kernelRows, cols, out, width, x);
+}
+
+// the 256 bit unpacks interleave within each 128 bit lane, so the sums hold the pixels 0-3 and 8-11
+// respectively 4-7 and 12-15 and are put in order when stored
+template <int ROWS, int COLS>
+IMAGECORE_TARGET_AVX2 static void convolve2DIntAVX2(const int16_t *const *rows, const int16_t *weights, int kernelRows, int cols, int32_t *out, int width)
+{
+    kernelRows = ROWS > 0 ? ROWS : kernelRows;
+    cols = COLS > 0 ? COLS : cols;
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i sum0 = _mm256_setzero_si256();
+        __m256i sum1 = _mm256_setzero_si256();
+        for (int v = 0; v < kernelRows; v++)
+        {
+            const int16_t *in = rows[v] + x;
+            for (int u = 0; u < cols; u += 2)
+            {
+                __m256i first = _mm256_loadu_si256((const __m256i *)(in + u));
+                __m256i second = u + 1 < cols ? _mm256_loadu_si256((const __m256i *)(in + u + 1)) : _mm256_setzero_si256();
+                __m256i weight = _mm256_set1_epi32(tapPair(weights + v * cols, u, cols));
+                sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(_mm256_unpacklo_epi16(first, second), weight));
+                sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(_mm256_unpackhi_epi16(first, second), weight));
+            }
+        }
+        _mm256_storeu_si256((__m256i *)(out + x), _mm256_permute2x128_si256(sum0, sum1, 0x20));
+        _mm256_storeu_si256((__m256i *)(out + x + 8), _mm256_permute2x128_si256(sum0, sum1, 0x31));
+    }
+    convolve2DIntScalar<ROWS, COLS>(rows, weights, kernelRows, cols, out, width, x);
+}
+
+static void recursiveStepSSE2(const float *in, const float *const *previous, const float *weights, float *out, int width)
+{
+    int x = 0;
+    for (; x + 4 <= width; x += 4)
+    {
+        __m128 sum = _mm_mul_ps(_mm_set1_ps(weights[0]), _mm_loadu_ps(in + x));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[1]), _mm_loadu_ps(previous[0] + x)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[2]), _mm_loadu_ps(previous[1] + x)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[3]), _mm_loadu_ps(previous[2] + x)));
+        _mm_storeu_ps(out + x, sum);
+    }
+    recursiveStepScalar(in, previous, weights, out, width, x);
+}
+
+IMAGECORE_TARGET_AVX2 static void recursiveStepAVX2(const float *in, const float *const *previous, const float *weights, float *out, int width)
+{
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m256 sum = _mm256_mul_ps(_mm256_set1_ps(weights[0]), _mm256_loadu_ps(in + x));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[1]), _mm256_loadu_ps(previous[0] + x)));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[2]), _mm256_loadu_ps(previous[1] + x)));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[3]), _mm256_loadu_ps(previous[2] + x)));
+        _mm256_storeu_ps(out + x, sum);
+    }
+    recursiveStepScalar(in, previous, weights, out, width, x);
+}
+
+#endif
+
+template <int STEP, typename T>
+static void convolve(const T *const *rows, const double *weights, int taps, double *out, int width)
+{
+    withTaps(taps, [=](auto size) {
+        const int TAPS = decltype(size)::value;
+        switch (simdLevel())
+        {
+#ifdef IMAGECORE_X86_SIMD
+        case SimdLevel::AVX2:
+            convolveAVX2<TAPS, STEP>(rows, weights, taps, out, width);
+            break;
+        case SimdLevel::SSE2:
+            convolveSSE2<TAPS, STEP>(rows, weights, taps, out, width);
+            break;
+#endif
+        default:
+            convolveScalar<TAPS, STEP>(rows, weights, taps, out, width, 0);
+        }
+    });
+}
+
+void convolveRow(const float *in, const double *weights, int taps, double *out, int width)
+{
+    convolve<1>(&in, weights, taps, out, width);
+}
+
+void convolveColumns(const float *const *rows, const double *weights, int taps, double *out, int width)
+{
+    convolve<0>(rows, weights, taps, out, width);
+}
+
+void convolveColumns(const double *const *rows, const double *weights, int taps, double *out, int width)
+{
+    convolve<0>(rows, weights, taps, out, width);
+}
+
+void convolve2D(const float *const *rows, const double *weights, int kernelRows, int cols, double *out, int width)
+{
+    // only square kernels have instantiations, like the ones of the filter table
+    withTaps(kernelRows == cols ? cols : 0, [=](auto size) {
+        const int SIZE = decltype(size)::value;
+        switch (simdLevel())
+        {
+#ifdef IMAGECORE_X86_SIMD
+        case SimdLevel::AVX2:
+            convolve2DAVX2<SIZE, SIZE>(rows, weights, kernelRows, cols, out, width);
+            break;
+        case SimdLevel::SSE2:
+            convolve2DSSE2<SIZE, SIZE>(rows, weights, kernelRows, cols, out, width);
+            break;
+#endif
+        default:
+            convolve2DScalar<SIZE, SIZE>(rows, weights, kernelRows, cols, out, width, 0);
+        }
+    });
+}
+
+void convolve2D(const int16_t *const *rows, const int16_t *weights, int kernelRows, int cols, int32_t *out, int width)
+{
+    withTaps(kernelRows == cols ? cols : 0, [=](auto size) {
+        const int SIZE = decltype(size)::value;
+        switch (simdLevel())
+        {
+#ifdef IMAGECORE_X86_SIMD
+        case SimdLevel::AVX2:
+            convolve2DIntAVX2<SIZE, SIZE>(rows, weights, kernelRows, cols, out, width);
+            break;
+        case SimdLevel::SSE2:
+            convolve2DIntSSE2<SIZE, SIZE>(rows, weights, kernelRows, cols, out, width);
+            break;
+#endif
+        default:
+            convolve2DIntScalar<SIZE, SIZE>(rows, weights, kernelRows, cols, out, width, 0);
+        }
+    });
+}
+
+void recursiveStep(const float *in, const float *const *previous, const float *weights, float *out, int width)
+{
+    switch (simdLevel())
+    {
+#ifdef IMAGECORE_X86_SIMD
+    case SimdLevel::AVX2:
+        recursiveStepAVX2(in, previous, weights, out, width);
+        break;
+    case SimdLevel::SSE2:
+        recursiveStepSSE2(in, previous, weights, out, width);
+        break;
+#endif
+    default:
+        recursiveStepScalar(in, previous, weights, out, width, 0);
+    }
+}
+
+} // namespace imagecore
@@ -0,0 +1,34 @@
+#ifndef IMAGECORE_CONVOLVE_H
+#define IMAGECORE_CONVOLVE_H
+
+/*
+ * Convolution kernels vectorized with SSE2/AVX2. The planes hold float,
+ * which stores every luma and truncated intermediate exactly, but the taps
+ * are summed in double and in order with separate multiplies and adds, so
+ * all instruction sets return the bits of the scalar double loop. Kernels
+ * with 3, 5 or 7 taps per dimension run unrolled instantiations.
+ */
+
+#include <cstdint>
+
+namespace imagecore
+{
+
+// out[x] = sum of weights[i] * in[x + i], in holds width + taps - 1 values
+void convolveRow(const float *in, const double *weights, int taps, double *out, int width);
+// out[x] = sum of weights[i] * rows[i][x]
+void convolveColumns(const float *const *rows, const double *weights, int taps, double *out, int width);
+// the same over rows of unrounded responses, e.g. of a horizontal pass
+void convolveColumns(const double *const *rows, const double *weights, int taps, double *out, int width);
+// out[x] = sum of weights[v * cols + u] * rows[v][x + u], rows hold width + cols - 1 values
+void convolve2D(const float *const *rows, const double *weights, int kernelRows, int cols, double *out, int width);
+// the same in integers for integer filters on the luma, the sums are exact as long as 255 times the sum
+// of the absolute weights fits into 32 bits, SSE2 and AVX2 multiply pairs of taps with pmaddwd
+void convolve2D(const int16_t *const *rows, const int16_t *weights, int kernelRows, int cols, int32_t *out, int width);
+// out[x] = weights[0] * in[x] + sum of weights[i] * previous[i - 1][x] for i = 1..3 in float,
+// one row of a third order recursive filter running down the columns
+void recursiveStep(const float *in, const float *const *previous, const float *weights, float *out, int width);
+
+} // namespace imagecore
+
+#endif
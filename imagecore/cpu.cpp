@@ -0,0 +1,48 @@
+#include "cpu.h"
+
+#include <atomic>
+
+namespace imagecore
+{
+
+static std::atomic<SimdLevel> currentLevel(detectSimdLevel());
+
+SimdLevel detectSimdLevel()
+{
+#ifdef IMAGECORE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return SimdLevel::AVX2;
+    }
+    return SimdLevel::SSE2;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel simdLevel()
+{
+    return currentLevel.load(std::memory_order_relaxed);
+}
+
+void setSimdLevel(SimdLevel level)
+{
+    SimdLevel supported = detectSimdLevel();
+    currentLevel.store(level > supported ? supported : level, std::memory_order_relaxed);
+}
+
+const char *simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::SSE2:
+        return "SSE2";
+    default:
+        return "scalar";
+    }
+}
+
+} // namespace imagecore
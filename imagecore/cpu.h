@@ -0,0 +1,34 @@
+#ifndef IMAGECORE_CPU_H
+#define IMAGECORE_CPU_H
+
+// vectorized kernels are written with x86 intrinsics, everything else uses the scalar code
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define IMAGECORE_X86_SIMD 1
+#endif
+
+#ifdef IMAGECORE_X86_SIMD
+// AVX2 kernels are compiled per function, the rest of the library stays at the baseline ISA
+#define IMAGECORE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace imagecore
+{
+
+enum class SimdLevel
+{
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// best instruction set the running CPU supports
+SimdLevel detectSimdLevel();
+// instruction set the kernels dispatch to, defaults to detectSimdLevel()
+SimdLevel simdLevel();
+// restricts the kernels to level (but never above what the CPU supports), for benchmarks and comparisons
+void setSimdLevel(SimdLevel level);
+const char *simdLevelName(SimdLevel level);
+
+} // namespace imagecore
+
+#endif
@@ -0,0 +1,204 @@
+#include "fft.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmisleading-indentation"
+#pragma GCC diagnostic ignored "-Wint-in-bool-context"
+#pragma GCC diagnostic ignored "-Wdeprecated-copy"
+#include "../utils/unsupported/Eigen/FFT"
+#pragma GCC diagnostic pop
+
+#include "parallel.h"
+
+namespace imagecore
+{
+
+typedef std::complex<double> Complex;
+
+// half spectrum of a real n_y x n_x block, n_y rows of n_x / 2 + 1 values
+struct Spectrum
+{
+    int n_x;
+    int n_y;
+    std::vector<Complex> values;
+
+    int columns() const
+    {
+        return n_x / 2 + 1;
+    }
+};
+
+// plans and scratch buffers of Eigen::FFT are not thread safe, so every thread keeps its own
+static Eigen::FFT<double> &threadFft()
+{
+    static thread_local Eigen::FFT<double> fft;
+    fft.SetFlag(Eigen::FFT<double>::HalfSpectrum);
+    return fft;
+}
+
+// transform size for one dimension, several kernel lengths long but not much more than the image
+static int fftSize(int kernel, int image)
+{
+    int size = 8;
+    while (size < 4 * (kernel - 1) && size < image + kernel - 1)
+    {
+        size *= 2;
+    }
+    return size;
+}
+
+// 2D forward transform of block (n_y rows of n_x values), rows first
+static void forward(const std::vector<double> &block, Spectrum &spectrum)
+{
+    Eigen::FFT<double> &fft = threadFft();
+    int columns = spectrum.columns();
+    spectrum.values.resize((size_t)spectrum.n_y * columns);
+    for (int y = 0; y < spectrum.n_y; y++)
+    {
+        fft.fwd(&spectrum.values[(size_t)y * columns], &block[(size_t)y * spectrum.n_x], spectrum.n_x);
+    }
+    std::vector<Complex> column(spectrum.n_y);
+    std::vector<Complex> transformed(spectrum.n_y);
+    for (int x = 0; x < columns; x++)
+    {
+        for (int y = 0; y < spectrum.n_y; y++)
+        {
+            column[y] = spectrum.values[(size_t)y * columns + x];
+        }
+        fft.fwd(transformed.data(), column.data(), spectrum.n_y);
+        for (int y = 0; y < spectrum.n_y; y++)
+        {
+            spectrum.values[(size_t)y * columns + x] = transformed[y];
+        }
+    }
+}
+
+// 2D inverse transform of spectrum into block, columns first
+static void inverse(Spectrum &spectrum, std::vector<double> &block)
+{
+    Eigen::FFT<double> &fft = threadFft();
+    int columns = spectrum.columns();
+    std::vector<Complex> column(spectrum.n_y);
+    std::vector<Complex> transformed(spectrum.n_y);
+    for (int x = 0; x < columns; x++)
+    {
+        for (int y = 0; y < spectrum.n_y; y++)
+        {
+            column[y] = spectrum.values[(size_t)y * columns + x];
+        }
+        fft.inv(transformed.data(), column.data(), spectrum.n_y);
+        for (int y = 0; y < spectrum.n_y; y++)
+        {
+            spectrum.values[(size_t)y * columns + x] = transformed[y];
+        }
+    }
+    block.resize((size_t)spectrum.n_y * spectrum.n_x);
+    for (int y = 0; y < spectrum.n_y; y++)
+    {
+        fft.inv(&block[(size_t)y * spectrum.n_x], &spectrum.values[(size_t)y * columns], spectrum.n_x);
+    }
+}
+
+struct CachedSpectrum
+{
+    Eigen::MatrixXd filter;
+    std::shared_ptr<const Spectrum> spectrum;
+};
+
+static const size_t SPECTRUM_CACHE_SIZE = 4;
+
+// spectrum of the flipped filter, a correlation with the filter is a convolution with it
+static std::shared_ptr<const Spectrum> filterSpectrum(const Eigen::MatrixXd &filter, int n_x, int n_y)
+{
+    static std::mutex mutex;
+    static std::vector<CachedSpectrum> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < cache.size(); i++)
+    {
+        const CachedSpectrum &entry = cache[i];
+        if (entry.spectrum->n_x == n_x && entry.spectrum->n_y == n_y && entry.filter.rows() == filter.rows()
+            && entry.filter.cols() == filter.cols() && entry.filter == filter)
+        {
+            // most recently used first
+            std::rotate(cache.begin(), cache.begin() + i, cache.begin() + i + 1);
+            return cache.front().spectrum;
+        }
+    }
+    std::vector<double> block((size_t)n_y * n_x, 0.0);
+    for (int v = 0; v < filter.rows(); v++)
+    {
+        for (int u = 0; u < filter.cols(); u++)
+        {
+            block[(size_t)(filter.rows() - 1 - v) * n_x + filter.cols() - 1 - u] = filter(v, u);
+        }
+    }
+    auto spectrum = std::make_shared<Spectrum>();
+    spectrum->n_x = n_x;
+    spectrum->n_y = n_y;
+    forward(block, *spectrum);
+    cache.insert(cache.begin(), CachedSpectrum{filter, spectrum});
+    if (cache.size() > SPECTRUM_CACHE_SIZE)
+    {
+        cache.pop_back();
+    }
+    return spectrum;
+}
+
+void fftFilter(const Plane<float> &padded, const Eigen::MatrixXd &filter, Plane<double> &response)
+{
+    int rows = filter.rows();
+    int cols = filter.cols();
+    int n_x = fftSize(cols, response.width());
+    int n_y = fftSize(rows, response.height());
+    // every tile transforms its output plus the kernel reach and keeps the part without wrap-around
+    int tile_x = n_x - cols + 1;
+    int tile_y = n_y - rows + 1;
+    int tiles_x = (response.width() + tile_x - 1) / tile_x;
+    int tiles_y = (response.height() + tile_y - 1) / tile_y;
+    std::shared_ptr<const Spectrum> kernel = filterSpectrum(filter, n_x, n_y);
+    bool isInteger = (filter.array() == filter.array().round()).all();
+
+    parallelFor(tiles_x * tiles_y, 1, [&padded, &response, &kernel, n_x, n_y, rows, cols, tile_x, tile_y, tiles_x, isInteger](int begin, int end) {
+        std::vector<double> block;
+        Spectrum spectrum{n_x, n_y, {}};
+        for (int tile = begin; tile < end; tile++)
+        {
+            int x_0 = (tile % tiles_x) * tile_x;
+            int y_0 = (tile / tiles_x) * tile_y;
+            block.assign((size_t)n_y * n_x, 0.0);
+            for (int y = 0; y < n_y && y_0 + y < padded.height(); y++)
+            {
+                const float *in = padded.row(y_0 + y) + x_0;
+                int count = std::min(n_x, padded.width() - x_0);
+                std::copy(in, in + count, &block[(size_t)y * n_x]);
+            }
+            forward(block, spectrum);
+            for (size_t i = 0; i < spectrum.values.size(); i++)
+            {
+                spectrum.values[i] *= kernel->values[i];
+            }
+            inverse(spectrum, block);
+
+            int count_x = std::min(tile_x, response.width() - x_0);
+            int count_y = std::min(tile_y, response.height() - y_0);
+            for (int y = 0; y < count_y; y++)
+            {
+                const double *filtered = &block[(size_t)(y + rows - 1) * n_x + cols - 1];
+                double *out = response.row(y_0 + y) + x_0;
+                for (int x = 0; x < count_x; x++)
+                {
+                    // integer taps on integer luma have an integer response
+                    out[x] = isInteger ? std::round(filtered[x]) : filtered[x];
+                }
+            }
+        }
+    });
+}
+
+} // namespace imagecore
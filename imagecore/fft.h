@@ -0,0 +1,36 @@
+#ifndef IMAGECORE_FFT_H
+#define IMAGECORE_FFT_H
+
+// eigen library for the filter matrices
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmisleading-indentation"
+#pragma GCC diagnostic ignored "-Wint-in-bool-context"
+#pragma GCC diagnostic ignored "-Wdeprecated-copy"
+#include "../utils/Eigen/Core"
+#pragma GCC diagnostic pop
+
+#include "plane.h"
+
+/*
+ * Filter response through the FFT for large kernels. The output is split
+ * into tiles that are transformed on their own (overlap-save), so the
+ * transforms stay small and the tiles run in parallel. The FFT plans live
+ * per thread and the spectra of the last few kernels are cached, applying
+ * the same filter again only transforms the image.
+ */
+
+namespace imagecore
+{
+
+// kernels with at least this many taps take the FFT path in applyFilter(), the filter benchmark has the direct
+// float loop ahead at 21x21 and the FFT ahead from 25x25 on; integer kernels stay in the faster integer loop
+// up to INTEGER_MAX_TAPS (filter.h)
+const int FFT_MIN_TAPS = 625;
+
+// response(x, y) = sum of filter(v, u) * padded(x + u, y + v) for the size of response, like the direct loop;
+// integer filters get an exact response, the others one within the rounding of the transforms
+void fftFilter(const Plane<float> &padded, const Eigen::MatrixXd &filter, Plane<double> &response);
+
+} // namespace imagecore
+
+#endif
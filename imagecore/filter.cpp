@@ -0,0 +1,525 @@
+#include "filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "color.h"
+#include "convolve.h"
+#include "fft.h"
+#include "iterate.h"
+
+namespace imagecore
+{
+
+// sum of the absolute tap weights, used to normalize the filter response
+static double tapWeight(const Eigen::VectorXd &H)
+{
+    double n = 0;
+    for (int i = 0; i < H.size(); i++)
+    {
+        n += std::abs(H(i));
+    }
+    return n;
+}
+
+// derivation responses become intensities around 127, everything else the new luma
+static int16_t responseToLuma(double value, double n, bool isDerivationFilter)
+{
+    return isDerivationFilter ? (int16_t)clamp(value + 127, 0, GRAY_SPECTRUM - 1) : toLuma(value / n);
+}
+
+int borderPad(int x, int y, const LumaPlane &image)
+{
+    return PadBorder()(x, y, image);
+}
+
+int borderConstant(int x, int y, const LumaPlane &image)
+{
+    return ConstantBorder()(x, y, image);
+}
+
+int borderMirror(int x, int y, const LumaPlane &image)
+{
+    return MirrorBorder()(x, y, image);
+}
+
+Eigen::VectorXd createGaussianKernel(double sigma)
+{
+    int center = (int)(sigma * 3.0);
+    Eigen::VectorXd h = Eigen::VectorXd(2 * center + 1);
+    double sigma2 = sigma * sigma;
+    for (int i = 0; i < h.size(); i++)
+    {
+        double r = center - i;
+        h[i] = (double)(exp(-0.5 * (r * r) / sigma2));
+    }
+    return h;
+}
+
+std::optional<Eigen::MatrixXd> readFilter(std::istream &in)
+{
+    std::vector<std::vector<double>> rows;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream values(line);
+        std::vector<double> row;
+        double value;
+        while (values >> value)
+        {
+            row.push_back(value);
+        }
+        if (!values.eof())
+        {
+            return std::nullopt;
+        }
+        if (row.empty())
+        {
+            continue;
+        }
+        if (!rows.empty() && row.size() != rows.front().size())
+        {
+            return std::nullopt;
+        }
+        rows.push_back(row);
+    }
+    if (rows.empty())
+    {
+        return std::nullopt;
+    }
+    Eigen::MatrixXd filter(rows.size(), rows.front().size());
+    for (int v = 0; v < filter.rows(); v++)
+    {
+        for (int u = 0; u < filter.cols(); u++)
+        {
+            filter(v, u) = rows[v][u];
+        }
+    }
+    return filter;
+}
+
+static std::vector<double> filterWeights(const Eigen::VectorXd &H)
+{
+    return std::vector<double>(H.data(), H.data() + H.size());
+}
+
+template <typename T>
+static Plane<T> padPlaneAs(const LumaPlane &source, int left, int top, int right, int bottom, const BorderStrategy &borderStrategy)
+{
+    Plane<T> padded(left + source.width() + right, top + source.height() + bottom);
+    withBorderPolicy(borderStrategy, [&source, &padded, left, top, right](auto border) {
+        parallelRows(padded, [&source, &border, left, top, right](int y, T *row) {
+            padRow(source, y - top, left, right, border, row);
+        });
+    });
+    return padded;
+}
+
+Plane<float> padPlane(const LumaPlane &source, int left, int top, int right, int bottom, const BorderStrategy &borderStrategy)
+{
+    return padPlaneAs<float>(source, left, top, right, bottom, borderStrategy);
+}
+
+LumaPlane padLumaPlane(const LumaPlane &source, int left, int top, int right, int bottom, const BorderStrategy &borderStrategy)
+{
+    return padPlaneAs<int16_t>(source, left, top, right, bottom, borderStrategy);
+}
+
+// horizontal pass, every row is padded into a scratch row so the kernel reads no border,
+// func(y, response) receives the response of each row
+template <typename Border, typename Func>
+static void filterRows(const LumaPlane &source, const Eigen::VectorXd &H, const Border &border, Func &&func)
+{
+    int width = source.width();
+    int taps = (int)H.size();
+    int x_h = taps / 2;
+    std::vector<double> weights = filterWeights(H);
+    parallelBands(width, source.height(), [&source, &weights, &border, &func, width, taps, x_h](int begin, int end) {
+        std::vector<float> padded(width + taps - 1);
+        std::vector<double> response(width);
+        for (int y = begin; y < end; y++)
+        {
+            padRow(source, y, x_h, taps - 1 - x_h, border, padded.data());
+            convolveRow(padded.data(), weights.data(), taps, response.data(), width);
+            func(y, response.data());
+        }
+    });
+}
+
+// columns per strip of the vertical pass, the rows of a few dozen taps stay in the L2 cache
+static const int COLUMN_STRIP = 1024;
+
+// vertical pass over a plane padded with taps - 1 halo rows, bands are walked in strips of columns,
+// func(y, x_0, count, response) receives the response of count pixels starting at x_0
+template <typename Func>
+static void filterColumns(const Plane<float> &padded, const Eigen::VectorXd &H, Func &&func)
+{
+    int width = padded.width();
+    int taps = (int)H.size();
+    std::vector<double> weights = filterWeights(H);
+    parallelBands(width, padded.height() - taps + 1, [&padded, &weights, &func, width, taps](int begin, int end) {
+        std::vector<const float *> rows(taps);
+        std::vector<double> response(std::min(COLUMN_STRIP, width));
+        for (int x_0 = 0; x_0 < width; x_0 += COLUMN_STRIP)
+        {
+            int count = std::min(COLUMN_STRIP, width - x_0);
+            for (int y = begin; y < end; y++)
+            {
+                for (int i = 0; i < taps; i++)
+                {
+                    rows[i] = padded.row(y + i) + x_0;
+                }
+                convolveColumns(rows.data(), weights.data(), taps, response.data(), count);
+                func(y, x_0, count, response.data());
+            }
+        }
+    });
+}
+
+double apply1DXFilter(const LumaPlane &source, const Eigen::VectorXd &H_x, const BorderStrategy &borderStrategy, Plane<float> &target)
+{
+    int width = source.width();
+    withBorderPolicy(borderStrategy, [&source, &H_x, &target, width](auto border) {
+        filterRows(source, H_x, border, [&target, width](int y, const double *response) {
+            std::copy(response, response + width, target.row(y));
+        });
+    });
+    return tapWeight(H_x);
+}
+
+double apply1DYFilter(const LumaPlane &source, const Eigen::VectorXd &H_y, const BorderStrategy &borderStrategy, Plane<float> &target)
+{
+    int y_h = (int)(H_y.size()) / 2;
+    Plane<float> padded = padPlane(source, 0, y_h, 0, H_y.size() - 1 - y_h, borderStrategy);
+    filterColumns(padded, H_y, [&target](int y, int x_0, int count, const double *response) {
+        std::copy(response, response + count, target.row(y) + x_0);
+    });
+    return tapWeight(H_y);
+}
+
+LumaPlane applySeparatedFilter(const Eigen::VectorXd &H_x, const Eigen::VectorXd &H_y, const LumaPlane &source, const FilterOptions &options)
+{
+    int width = source.width();
+    int height = source.height();
+    bool isDerivationFilter = options.isDerivationFilter;
+
+    int y_h = (int)(H_y.size()) / 2;
+    Plane<float> buffer(width, height + H_y.size() - 1);
+    double n_x = tapWeight(H_x);
+    withBorderPolicy(options.borderStrategy, [&source, &H_x, &buffer, width, height, y_h, n_x, isDerivationFilter](auto border) {
+        // the halo rows of the y pass are read from the unfiltered luma
+        for (int i = 0; i < y_h; i++)
+        {
+            padRow(source, i - y_h, 0, 0, border, buffer.row(i));
+        }
+        for (int y = height; y < buffer.height() - y_h; y++)
+        {
+            padRow(source, y, 0, 0, border, buffer.row(y_h + y));
+        }
+
+        // apply 1D filter x dimenstion, the y pass reads the integer part of the normalized response
+        filterRows(source, H_x, border, [&buffer, width, n_x, y_h, isDerivationFilter](int y, const double *response) {
+            float *filtered = buffer.row(y_h + y);
+            for (int x = 0; x < width; x++)
+            {
+                filtered[x] = (int)(isDerivationFilter ? response[x] : response[x] / n_x);
+            }
+        });
+    });
+
+    // apply 1D filter y dimenstion
+    LumaPlane target(width, height);
+    double n_y = tapWeight(H_y);
+    filterColumns(buffer, H_y, [&target, n_y, isDerivationFilter](int y, int x_0, int count, const double *response) {
+        int16_t *out = target.row(y) + x_0;
+        for (int x = 0; x < count; x++)
+        {
+            out[x] = responseToLuma(response[x], n_y, isDerivationFilter);
+        }
+    });
+    return target;
+}
+
+// sum of the rank separable terms of the svd over padded, each term is a horizontal pass into a
+// double plane and a vertical pass over it, so the terms add up to the 2D response unrounded
+static void applyLowRankFilter(const Eigen::JacobiSVD<Eigen::MatrixXd> &svd, int rank, const Plane<float> &padded, Plane<double> &response)
+{
+    int width = response.width();
+    int rows = (int)svd.matrixU().rows();
+    int cols = (int)svd.matrixV().rows();
+    Plane<double> horizontal(width, padded.height());
+    for (int i = 0; i < rank; i++)
+    {
+        double scale = std::sqrt(svd.singularValues()[i]);
+        std::vector<double> H_x(cols);
+        std::vector<double> H_y(rows);
+        for (int u = 0; u < cols; u++)
+        {
+            H_x[u] = svd.matrixV()(u, i) * scale;
+        }
+        for (int v = 0; v < rows; v++)
+        {
+            H_y[v] = svd.matrixU()(v, i) * scale;
+        }
+        parallelRows(horizontal, [&padded, &H_x, cols, width](int y, double *out) {
+            convolveRow(padded.row(y), H_x.data(), cols, out, width);
+        });
+        parallelBands(width, response.height(), [&horizontal, &response, &H_y, rows, width, i](int begin, int end) {
+            std::vector<const double *> lines(rows);
+            std::vector<double> term(std::min(COLUMN_STRIP, width));
+            for (int x_0 = 0; x_0 < width; x_0 += COLUMN_STRIP)
+            {
+                int count = std::min(COLUMN_STRIP, width - x_0);
+                for (int y = begin; y < end; y++)
+                {
+                    for (int v = 0; v < rows; v++)
+                    {
+                        lines[v] = horizontal.row(y + v) + x_0;
+                    }
+                    convolveColumns(lines.data(), H_y.data(), rows, term.data(), count);
+                    double *out = response.row(y) + x_0;
+                    for (int x = 0; x < count; x++)
+                    {
+                        out[x] = i == 0 ? term[x] : out[x] + term[x];
+                    }
+                }
+            }
+        });
+    }
+}
+
+// integer taps cost about this fraction of a double tap of the separable passes
+static const int INTEGER_TAP_SPEEDUP = 8;
+
+// integer taps small enough that the sums over the luma fit into the 32 bit accumulators
+static bool isIntegerFilter(const Eigen::MatrixXd &filter)
+{
+    return (filter.array() == filter.array().round()).all() && filter.cwiseAbs().maxCoeff() <= INT16_MAX
+           && filter.cwiseAbs().sum() * (GRAY_SPECTRUM - 1) <= INT32_MAX;
+}
+
+// direct 2D loop over the padded luma in integers, exact like the double loop but several times faster
+static void applyIntegerFilter(const Eigen::MatrixXd &filter, const LumaPlane &padded, double n, bool isDerivationFilter, LumaPlane &target)
+{
+    int width = target.width();
+    int kernelRows = filter.rows();
+    int cols = filter.cols();
+    std::vector<int16_t> weights;
+    for (int v = 0; v < kernelRows; v++)
+    {
+        for (int u = 0; u < cols; u++)
+        {
+            weights.push_back((int16_t)filter(v, u));
+        }
+    }
+    parallelBands(width, target.height(), [&padded, &weights, &target, width, n, kernelRows, cols, isDerivationFilter](int begin, int end) {
+        std::vector<const int16_t *> rows(kernelRows);
+        std::vector<int32_t> response(width);
+        for (int y = begin; y < end; y++)
+        {
+            for (int v = 0; v < kernelRows; v++)
+            {
+                rows[v] = padded.row(y + v);
+            }
+            convolve2D(rows.data(), weights.data(), kernelRows, cols, response.data(), width);
+            int16_t *out = target.row(y);
+            for (int x = 0; x < width; x++)
+            {
+                out[x] = responseToLuma(response[x], n, isDerivationFilter);
+            }
+        }
+    });
+}
+
+LumaPlane applyFilter(const Eigen::MatrixXd &filter, const LumaPlane &source, const FilterOptions &options, std::ostream *log)
+{
+    // check if separable using SVD
+    Eigen::JacobiSVD<Eigen::MatrixXd> svd(filter, Eigen::ComputeThinU | Eigen::ComputeThinV);
+    int rank = (int)svd.rank();
+    if (options.approximationRank > 0)
+    {
+        rank = std::min(rank, options.approximationRank);
+    }
+    bool isExact = rank == svd.rank();
+    // integer taps on integer luma have an integer response, it is divided by n only at the end
+    bool isIntegral = isExact && (filter.array() == filter.array().round()).all();
+    // truncated filters take the separable terms below, which keep the normalization of the whole filter
+    bool isSeparable = rank == 1 && isExact;
+
+    if (isSeparable && !isIntegral)
+    {
+        // thanks to https://web.archive.org/web/20200804115435/https://bartwronski.com/2020/02/03/separate-your-filters-svd-and-low-rank-approximation-of-image-filters/
+        Eigen::VectorXd H_x = svd.matrixV()(Eigen::all, 0) * sqrt(svd.singularValues()[0]);
+        Eigen::VectorXd H_y = svd.matrixU()(Eigen::all, 0) * sqrt(svd.singularValues()[0]);
+        if (log != nullptr)
+        {
+            *log << "Filter is separable!" << std::endl;
+            *log << "H_x:" << std::endl
+                 << H_x << std::endl;
+            *log << "H_y:" << std::endl
+                 << H_y << std::endl;
+        }
+        return applySeparatedFilter(H_x, H_y, source, options);
+    }
+
+    int width = source.width();
+    int height = source.height();
+    double n = 0.0;
+    std::vector<double> weights;
+    for (int v = 0; v < filter.rows(); v++)
+    {
+        for (int u = 0; u < filter.cols(); u++)
+        {
+            n += std::abs(filter(v, u));
+            weights.push_back(filter(v, u));
+        }
+    }
+    if (n == 0.0)
+    {
+        // an all-zero table has a zero response, which is kept as it is instead of dividing by zero
+        if (log != nullptr)
+        {
+            *log << "Filter has only zero taps, its response is not normalized" << std::endl;
+        }
+        n = 1.0;
+    }
+    int x_h = (int)(filter.cols()) / 2;
+    int y_h = (int)(filter.rows()) / 2;
+    int right = (int)filter.cols() - 1 - x_h;
+    int bottom = (int)filter.rows() - 1 - y_h;
+    LumaPlane target(width, height);
+
+    // taps per pixel of the 2D loop against the separable terms, the FFT costs about as much as FFT_MIN_TAPS taps
+    int directTaps = std::min((int)filter.size(), FFT_MIN_TAPS);
+    int lowRankTaps = rank * (int)(filter.rows() + filter.cols());
+    // a requested approximation is applied even where it is not cheaper
+    bool isLowRank = rank > 0 && (lowRankTaps < directTaps || !isExact);
+
+    if (isIntegral && filter.size() <= INTEGER_MAX_TAPS && (!isLowRank || filter.size() < INTEGER_TAP_SPEEDUP * lowRankTaps) && isIntegerFilter(filter))
+    {
+        if (log != nullptr)
+        {
+            *log << "Filter is applied in integers" << std::endl;
+        }
+        LumaPlane padded = padLumaPlane(source, x_h, y_h, right, bottom, options.borderStrategy);
+        applyIntegerFilter(filter, padded, n, options.isDerivationFilter, target);
+        return target;
+    }
+
+    Plane<float> padded = padPlane(source, x_h, y_h, right, bottom, options.borderStrategy);
+    if (isLowRank)
+    {
+        // the discarded terms change a response by at most their Frobenius norm times the one of a 255 patch
+        double residual = svd.singularValues().tail(svd.singularValues().size() - rank).norm();
+        if (log != nullptr)
+        {
+            *log << "Filter has rank " << svd.rank() << ", applied as " << rank << " separable passes, predicted speedup "
+                 << (double)directTaps / lowRankTaps << "x" << std::endl;
+            if (lowRankTaps >= directTaps)
+            {
+                *log << "(" << lowRankTaps << " taps per pixel, not fewer than the " << directTaps << " of the exact filter)" << std::endl;
+            }
+            if (!isExact)
+            {
+                *log << "Approximation error at most " << residual * 255 * std::sqrt((double)filter.size()) / (options.isDerivationFilter ? 1 : n)
+                     << " gray levels" << std::endl;
+            }
+        }
+        Plane<double> response(width, height);
+        applyLowRankFilter(svd, rank, padded, response);
+        // the passes only add rounding noise to integer responses
+        parallelRows(target, [&response, &options, width, n, isIntegral](int y, int16_t *out) {
+            const double *filtered = response.row(y);
+            for (int x = 0; x < width; x++)
+            {
+                out[x] = responseToLuma(isIntegral ? std::round(filtered[x]) : filtered[x], n, options.isDerivationFilter);
+            }
+        });
+        return target;
+    }
+
+    if (filter.size() >= FFT_MIN_TAPS)
+    {
+        if (log != nullptr)
+        {
+            *log << "Filter is applied through the FFT" << std::endl;
+        }
+        Plane<double> response(width, height);
+        fftFilter(padded, filter, response);
+        parallelRows(target, [&response, &options, width, n](int y, int16_t *out) {
+            const double *filtered = response.row(y);
+            for (int x = 0; x < width; x++)
+            {
+                out[x] = responseToLuma(filtered[x], n, options.isDerivationFilter);
+            }
+        });
+        return target;
+    }
+    int kernelRows = filter.rows();
+    int cols = filter.cols();
+    parallelBands(width, height, [&padded, &weights, &target, &options, width, n, kernelRows, cols](int begin, int end) {
+        std::vector<const float *> rows(kernelRows);
+        std::vector<double> response(width);
+        for (int y = begin; y < end; y++)
+        {
+            for (int v = 0; v < kernelRows; v++)
+            {
+                rows[v] = padded.row(y + v);
+            }
+            convolve2D(rows.data(), weights.data(), kernelRows, cols, response.data(), width);
+            int16_t *out = target.row(y);
+            for (int x = 0; x < width; x++)
+            {
+                out[x] = responseToLuma(response[x], n, options.isDerivationFilter);
+            }
+        }
+    });
+    return target;
+}
+
+LumaPlane applyGaussianFilter(double sigma, const LumaPlane &source, const BorderStrategy &borderStrategy, GaussianMethod method)
+{
+    if (selectGaussianMethod(sigma, method) == GaussianMethod::IIR)
+    {
+        return applyRecursiveGaussianFilter(sigma, source, borderStrategy);
+    }
+    Eigen::VectorXd kernel = createGaussianKernel(sigma);
+    FilterOptions options;
+    options.borderStrategy = borderStrategy;
+    return applySeparatedFilter(kernel, kernel, source, options);
+}
+
+void gradient(const LumaPlane &image, const BorderStrategy &borderStrategy, Plane<float> &E_mag)
+{
+    Plane<float> I_x(image.width(), image.height());
+    Plane<float> I_y(image.width(), image.height());
+    calculateGradient(image, borderStrategy, I_x, I_y, E_mag);
+}
+
+void calculateGradient(const LumaPlane &image, const BorderStrategy &borderStrategy, Plane<float> &I_x, Plane<float> &I_y, Plane<float> &E_mag)
+{
+    Eigen::VectorXd gradient(3);
+    gradient[0] = -0.5;
+    gradient[1] = 0;
+    gradient[2] = 0.5;
+
+    apply1DXFilter(image, gradient, borderStrategy, I_x);
+    apply1DYFilter(image, gradient, borderStrategy, I_y);
+
+    int width = image.width();
+    parallelRows(E_mag, [&I_x, &I_y, width](int y, float *magnitude) {
+        const float *d_x = I_x.row(y);
+        const float *d_y = I_y.row(y);
+        for (int x = 0; x < width; x++)
+        {
+            magnitude[x] = std::sqrt(d_x[x] * d_x[x] + d_y[x] * d_y[x]);
+        }
+    });
+}
+
+} // namespace imagecore
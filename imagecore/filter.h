@@ -0,0 +1,62 @@
+#ifndef IMAGECORE_FILTER_H
+#define IMAGECORE_FILTER_H
+
+// eigen library for matrix SVD
+#pragma GCC diagnostic push
+// -Wall didn't work for some reason
+#pragma GCC diagnostic ignored "-Wmisleading-indentation"
+#pragma GCC diagnostic ignored "-Wint-in-bool-context"
+#pragma GCC diagnostic ignored "-Wdeprecated-copy"
+#include "../utils/Eigen/SVD"
+#include "../utils/Eigen/Core"
+#pragma GCC diagnostic pop
+
+#include <istream>
+#include <optional>
+#include <ostream>
+
+#include "border.h"
+#include "color.h"
+#include "gaussian.h"
+#include "plane.h"
+
+namespace imagecore
+{
+
+// copy of the luma widened to float with a halo of border values around it, so filters read it
+// without any range checks, the pixel (x, y) of source is (left + x, top + y)
+Plane<float> padPlane(const LumaPlane &source, int left, int top, int right, int bottom, const BorderStrategy &borderStrategy);
+// the same without widening, for the integer kernels
+LumaPlane padLumaPlane(const LumaPlane &source, int left, int top, int right, int bottom, const BorderStrategy &borderStrategy);
+
+// integer filters up to this many taps are summed in integers by applyFilter(), unless a few separable passes
+// are cheaper, the integer loop beats the FFT up to about 31x31, the float loop only below FFT_MIN_TAPS (fft.h)
+const int INTEGER_MAX_TAPS = 1024;
+
+struct FilterOptions
+{
+    BorderStrategy borderStrategy = borderPad;
+    bool isDerivationFilter = false;
+    // applyFilter() keeps at most this many separable terms of the filter, 0 keeps its numerical rank
+    int approximationRank = 0;
+};
+
+Eigen::VectorXd createGaussianKernel(double sigma);
+// read a filter matrix written as one row of whitespace separated numbers per line, # starts a comment,
+// returns nothing if a row is malformed, the rows differ in length or there are none
+std::optional<Eigen::MatrixXd> readFilter(std::istream &in);
+
+// write the filter response of the luma to target, rounded to float, and return the sum of the absolute tap weights
+double apply1DXFilter(const LumaPlane &source, const Eigen::VectorXd &H_x, const BorderStrategy &borderStrategy, Plane<float> &target);
+double apply1DYFilter(const LumaPlane &source, const Eigen::VectorXd &H_y, const BorderStrategy &borderStrategy, Plane<float> &target);
+// return the filtered luma, derivation filters return gray intensities around 127 instead (see grayToRgb())
+LumaPlane applySeparatedFilter(const Eigen::VectorXd &H_x, const Eigen::VectorXd &H_y, const LumaPlane &source, const FilterOptions &options);
+LumaPlane applyFilter(const Eigen::MatrixXd &filter, const LumaPlane &source, const FilterOptions &options, std::ostream *log = nullptr);
+LumaPlane applyGaussianFilter(double sigma, const LumaPlane &source, const BorderStrategy &borderStrategy, GaussianMethod method = GaussianMethod::Auto);
+
+void gradient(const LumaPlane &image, const BorderStrategy &borderStrategy, Plane<float> &E_mag);
+void calculateGradient(const LumaPlane &image, const BorderStrategy &borderStrategy, Plane<float> &I_x, Plane<float> &I_y, Plane<float> &E_mag);
+
+} // namespace imagecore
+
+#endif
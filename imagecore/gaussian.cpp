@@ -0,0 +1,192 @@
+#include "gaussian.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "convolve.h"
+#include "iterate.h"
+#include "parallel.h"
+
+namespace imagecore
+{
+
+GaussianMethod selectGaussianMethod(double sigma, GaussianMethod method)
+{
+    if (method != GaussianMethod::Auto)
+    {
+        return method;
+    }
+    return sigma < IIR_MIN_SIGMA ? GaussianMethod::FIR : GaussianMethod::IIR;
+}
+
+const char *gaussianMethodName(GaussianMethod method)
+{
+    switch (method)
+    {
+    case GaussianMethod::FIR:
+        return "FIR";
+    case GaussianMethod::IIR:
+        return "IIR";
+    default:
+        return "auto";
+    }
+}
+
+// B, b1, b2 and b3 of the paper with b0 divided out
+static std::array<float, 4> recursiveWeights(double sigma)
+{
+    double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330 : 3.97156 - 4.14554 * sqrt(1 - 0.26891 * sigma);
+    double q2 = q * q;
+    double q3 = q2 * q;
+    double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    double b1 = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+    double b2 = -(1.4281 * q2 + 1.26661 * q3) / b0;
+    double b3 = 0.422205 * q3 / b0;
+    return {(float)(1 - (b1 + b2 + b3)), (float)b1, (float)b2, (float)b3};
+}
+
+// lines run through the horizontal recursion together, their independent sums hide the latency of each step
+static const int INTERLEAVED_LINES = 4;
+
+// forward and backward pass over INTERLEAVED_LINES lines of n values, both ends start from a constant signal
+static void recursiveLines(float *const *lines, int n, const std::array<float, 4> &weights)
+{
+    const int L = INTERLEAVED_LINES;
+    float w_1[L], w_2[L], w_3[L];
+    for (int l = 0; l < L; l++)
+    {
+        w_1[l] = w_2[l] = w_3[l] = lines[l][0];
+    }
+    for (int i = 0; i < n; i++)
+    {
+        for (int l = 0; l < L; l++)
+        {
+            float w = weights[0] * lines[l][i] + weights[1] * w_1[l] + weights[2] * w_2[l] + weights[3] * w_3[l];
+            lines[l][i] = w;
+            w_3[l] = w_2[l];
+            w_2[l] = w_1[l];
+            w_1[l] = w;
+        }
+    }
+    for (int l = 0; l < L; l++)
+    {
+        w_1[l] = w_2[l] = w_3[l] = lines[l][n - 1];
+    }
+    for (int i = n - 1; i >= 0; i--)
+    {
+        for (int l = 0; l < L; l++)
+        {
+            float w = weights[0] * lines[l][i] + weights[1] * w_1[l] + weights[2] * w_2[l] + weights[3] * w_3[l];
+            lines[l][i] = w;
+            w_3[l] = w_2[l];
+            w_2[l] = w_1[l];
+            w_1[l] = w;
+        }
+    }
+}
+
+// the recursion rounds the response of a constant signal to just below it, which would truncate a whole intensity
+static int truncateResponse(float value)
+{
+    return (int)(value + 1e-3f);
+}
+
+// columns per strip of the vertical pass
+static const int RECURSIVE_STRIP = 256;
+
+LumaPlane applyRecursiveGaussianFilter(double sigma, const LumaPlane &source, const BorderStrategy &borderStrategy)
+{
+    int width = source.width();
+    int height = source.height();
+    int halo = std::max(3, (int)(sigma * 3.0));
+    std::array<float, 4> weights = recursiveWeights(sigma);
+
+    // horizontal pass, the halo rows of the vertical pass are read from the unfiltered luma like in applySeparatedFilter()
+    Plane<float> buffer(width, height + 2 * halo);
+    withBorderPolicy(borderStrategy, [&source, &buffer, &weights, width, height, halo](auto border) {
+        parallelBands(width, buffer.height(), [&source, &buffer, &weights, &border, width, height, halo](int begin, int end) {
+            int length = width + 2 * halo;
+            std::vector<float> scratch(INTERLEAVED_LINES * length);
+            float *lines[INTERLEAVED_LINES];
+            int rows[INTERLEAVED_LINES];
+            int count = 0;
+            for (int y = begin; y < end; y++)
+            {
+                int y_pos = y - halo;
+                if (y_pos < 0 || y_pos > height - 1)
+                {
+                    padRow(source, y_pos, 0, 0, border, buffer.row(y));
+                }
+                else
+                {
+                    lines[count] = scratch.data() + count * length;
+                    rows[count] = y;
+                    padRow(source, y_pos, halo, halo, border, lines[count]);
+                    count++;
+                }
+                if (count == INTERLEAVED_LINES || (y == end - 1 && count > 0))
+                {
+                    // the unused lines of a last group that is not full filter stale scratch values
+                    for (int l = count; l < INTERLEAVED_LINES; l++)
+                    {
+                        lines[l] = scratch.data() + l * length;
+                    }
+                    recursiveLines(lines, length, weights);
+                    for (int l = 0; l < count; l++)
+                    {
+                        float *filtered = buffer.row(rows[l]);
+                        for (int x = 0; x < width; x++)
+                        {
+                            filtered[x] = truncateResponse(lines[l][halo + x]);
+                        }
+                    }
+                    count = 0;
+                }
+            }
+        });
+    });
+
+    // vertical pass in place, strips of columns run down and back up the buffer
+    int rows = buffer.height();
+    LumaPlane target(width, height);
+    int strips = (width + RECURSIVE_STRIP - 1) / RECURSIVE_STRIP;
+    parallelFor(strips, 1, [&buffer, &target, &weights, width, height, halo, rows](int begin, int end) {
+        for (int x_0 = begin * RECURSIVE_STRIP; x_0 < std::min(end * RECURSIVE_STRIP, width); x_0 += RECURSIVE_STRIP)
+        {
+            int count = std::min(RECURSIVE_STRIP, width - x_0);
+            std::vector<float> first(buffer.row(0) + x_0, buffer.row(0) + x_0 + count);
+            const float *previous[3];
+            for (int y = 0; y < rows; y++)
+            {
+                for (int i = 0; i < 3; i++)
+                {
+                    previous[i] = y - 1 - i >= 0 ? buffer.row(y - 1 - i) + x_0 : first.data();
+                }
+                recursiveStep(buffer.row(y) + x_0, previous, weights.data(), buffer.row(y) + x_0, count);
+            }
+            std::vector<float> last(buffer.row(rows - 1) + x_0, buffer.row(rows - 1) + x_0 + count);
+            for (int y = rows - 1; y >= 0; y--)
+            {
+                for (int i = 0; i < 3; i++)
+                {
+                    previous[i] = y + 1 + i < rows ? buffer.row(y + 1 + i) + x_0 : last.data();
+                }
+                recursiveStep(buffer.row(y) + x_0, previous, weights.data(), buffer.row(y) + x_0, count);
+            }
+            for (int y = 0; y < height; y++)
+            {
+                const float *filtered = buffer.row(halo + y) + x_0;
+                int16_t *out = target.row(y) + x_0;
+                for (int x = 0; x < count; x++)
+                {
+                    out[x] = toLuma(truncateResponse(filtered[x]));
+                }
+            }
+        }
+    });
+    return target;
+}
+
+} // namespace imagecore
@@ -0,0 +1,32 @@
+#ifndef IMAGECORE_GAUSSIAN_H
+#define IMAGECORE_GAUSSIAN_H
+
+#include "border.h"
+#include "color.h"
+
+namespace imagecore
+{
+
+enum class GaussianMethod
+{
+    // FIR below IIR_MIN_SIGMA, IIR from there on
+    Auto,
+    // separable kernel with 6 * sigma + 1 taps, cost grows with sigma
+    FIR,
+    // recursive filter with a constant cost per pixel
+    IIR
+};
+
+// from here on the recursive filter is faster than the kernel and within a few intensities of it (see bench "gauss")
+const double IIR_MIN_SIGMA = 4.0;
+
+GaussianMethod selectGaussianMethod(double sigma, GaussianMethod method = GaussianMethod::Auto);
+const char *gaussianMethodName(GaussianMethod method);
+
+// Young and van Vliet, "Recursive implementation of the Gaussian filter", 1995; the borders are
+// handled like the kernel does, with a halo of 3 * sigma pixels and unfiltered halo rows
+LumaPlane applyRecursiveGaussianFilter(double sigma, const LumaPlane &source, const BorderStrategy &borderStrategy);
+
+} // namespace imagecore
+
+#endif
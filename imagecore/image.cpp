@@ -0,0 +1,14 @@
+#include "image.h"
+
+namespace imagecore
+{
+
+Image::Image()
+{
+}
+
+Image::Image(int width, int height) : Plane<Rgb>(width, height)
+{
+}
+
+} // namespace imagecore
@@ -0,0 +1,79 @@
+#ifndef IMAGECORE_IMAGE_H
+#define IMAGECORE_IMAGE_H
+#define GRAY_SPECTRUM 256
+
+#include <array>
+#include <cstdint>
+
+#include "plane.h"
+
+namespace imagecore
+{
+
+// 0xffRRGGBB, the same memory layout as QImage::Format_RGB32
+typedef uint32_t Rgb;
+typedef std::array<int, GRAY_SPECTRUM> Histogram;
+
+inline int red(Rgb rgb)
+{
+    return (rgb >> 16) & 0xff;
+}
+inline int green(Rgb rgb)
+{
+    return (rgb >> 8) & 0xff;
+}
+inline int blue(Rgb rgb)
+{
+    return rgb & 0xff;
+}
+inline Rgb rgb(int red, int green, int blue)
+{
+    return 0xff000000u | ((red & 0xff) << 16) | ((green & 0xff) << 8) | (blue & 0xff);
+}
+
+/*
+ * Interleaved RGB image buffer without any dependency on Qt. Mirrors the
+ * parts of the QImage API the algorithms need, the pixels of a freshly
+ * constructed image are undefined until they are written. Hot loops should
+ * walk the image with scanLine() instead of pixel()/setPixel().
+ */
+class Image : public Plane<Rgb>
+{
+public:
+    Image();
+    Image(int width, int height);
+
+    Rgb *scanLine(int y)
+    {
+        return row(y);
+    }
+    const Rgb *scanLine(int y) const
+    {
+        return row(y);
+    }
+    Rgb *bits()
+    {
+        return data();
+    }
+    const Rgb *bits() const
+    {
+        return data();
+    }
+    int bytesPerLine() const
+    {
+        return stride() * sizeof(Rgb);
+    }
+
+    Rgb pixel(int x, int y) const
+    {
+        return (*this)(x, y);
+    }
+    void setPixel(int x, int y, Rgb value)
+    {
+        (*this)(x, y) = value;
+    }
+};
+
+} // namespace imagecore
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef IMAGECORE_H
+#define IMAGECORE_H
+
+/*
+ * Headless image processing core. Every operation takes an image buffer plus
+ * its parameters and returns a new buffer; nothing in here depends on Qt.
+ */
+
+#include "border.h"
+#include "canny.h"
+#include "color.h"
+#include "convolve.h"
+#include "cpu.h"
+#include "fft.h"
+#include "filter.h"
+#include "gaussian.h"
+#include "image.h"
+#include "iterate.h"
+#include "lut.h"
+#include "operations.h"
+#include "parallel.h"
+#include "scale.h"
+#include "usm.h"
+#include "worker.h"
+
+#endif
@@ -0,0 +1,38 @@
+CONFIG += c++17 thread
+
+INCLUDEPATH += $$PWD
+# the vendored eigen fft includes <Eigen/Core>
+INCLUDEPATH += $$PWD/../utils
+
+HEADERS += $$PWD/imagecore.h \
+           $$PWD/plane.h \
+           $$PWD/image.h \
+           $$PWD/iterate.h \
+           $$PWD/border.h \
+           $$PWD/lut.h \
+           $$PWD/color.h \
+           $$PWD/cpu.h \
+           $$PWD/convolve.h \
+           $$PWD/fft.h \
+           $$PWD/operations.h \
+           $$PWD/parallel.h \
+           $$PWD/scale.h \
+           $$PWD/filter.h \
+           $$PWD/gaussian.h \
+           $$PWD/canny.h \
+           $$PWD/usm.h \
+           $$PWD/worker.h
+SOURCES += $$PWD/image.cpp \
+           $$PWD/color.cpp \
+           $$PWD/cpu.cpp \
+           $$PWD/convolve.cpp \
+           $$PWD/fft.cpp \
+           $$PWD/lut.cpp \
+           $$PWD/operations.cpp \
+           $$PWD/parallel.cpp \
+           $$PWD/scale.cpp \
+           $$PWD/filter.cpp \
+           $$PWD/gaussian.cpp \
+           $$PWD/canny.cpp \
+           $$PWD/usm.cpp \
+           $$PWD/worker.cpp
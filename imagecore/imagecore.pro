@@ -0,0 +1,7 @@
+# headless image processing library, no Qt modules required
+TEMPLATE = lib
+CONFIG += staticlib
+CONFIG -= qt
+TARGET = imagecore
+
+include(imagecore.pri)
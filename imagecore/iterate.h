@@ -0,0 +1,133 @@
+#ifndef IMAGECORE_ITERATE_H
+#define IMAGECORE_ITERATE_H
+
+#include <algorithm>
+
+#include "parallel.h"
+#include "plane.h"
+
+/*
+ * Iteration primitives for the algorithms. All of them walk row by row so
+ * memory is read sequentially, and take the kernel as a template parameter
+ * so the compiler can inline it into the loop.
+ */
+
+namespace imagecore
+{
+
+// calls func(x, y) for every position, x is the inner loop
+template <typename Func>
+inline void iterateRect(int width, int height, Func &&func)
+{
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            func(x, y);
+        }
+    }
+}
+
+template <typename T, typename Func>
+inline void iteratePixels(const Plane<T> &plane, Func &&func)
+{
+    iterateRect(plane.width(), plane.height(), func);
+}
+
+// calls func(y, row) for every row of plane
+template <typename T, typename Func>
+inline void iterateRows(Plane<T> &plane, Func &&func)
+{
+    for (int y = 0; y < plane.height(); y++)
+    {
+        func(y, plane.row(y));
+    }
+}
+
+template <typename T, typename Func>
+inline void iterateRows(const Plane<T> &plane, Func &&func)
+{
+    for (int y = 0; y < plane.height(); y++)
+    {
+        func(y, plane.row(y));
+    }
+}
+
+// calls func(y, sourceRow, targetRow) for every row, both planes need the same size
+template <typename S, typename T, typename Func>
+inline void iterateRows(const Plane<S> &source, Plane<T> &target, Func &&func)
+{
+    for (int y = 0; y < source.height(); y++)
+    {
+        func(y, source.row(y), target.row(y));
+    }
+}
+
+// target(x, y) = func(source(x, y)) for every pixel
+template <typename S, typename T, typename Func>
+inline void transformPixels(const Plane<S> &source, Plane<T> &target, Func &&func)
+{
+    int width = source.width();
+    iterateRows(source, target, [width, &func](int, const S *in, T *out) {
+        for (int x = 0; x < width; x++)
+        {
+            out[x] = func(in[x]);
+        }
+    });
+}
+
+/*
+ * Parallel versions of the primitives above. The rows are split into bands
+ * that run on the thread pool, so func must only write to its own rows.
+ */
+
+// rows per band so that a band holds enough pixels to be worth a task
+inline int rowGrain(int width)
+{
+    return std::max(1, (1 << 14) / std::max(width, 1));
+}
+
+// calls func(begin, end) for bands of rows covering [0, height)
+template <typename Func>
+inline void parallelBands(int width, int height, Func &&func)
+{
+    parallelFor(height, rowGrain(width), func);
+}
+
+template <typename T, typename Func>
+inline void parallelRows(Plane<T> &plane, Func &&func)
+{
+    parallelBands(plane.width(), plane.height(), [&plane, &func](int begin, int end) {
+        for (int y = begin; y < end; y++)
+        {
+            func(y, plane.row(y));
+        }
+    });
+}
+
+template <typename S, typename T, typename Func>
+inline void parallelRows(const Plane<S> &source, Plane<T> &target, Func &&func)
+{
+    parallelBands(source.width(), source.height(), [&source, &target, &func](int begin, int end) {
+        for (int y = begin; y < end; y++)
+        {
+            func(y, source.row(y), target.row(y));
+        }
+    });
+}
+
+template <typename S, typename T, typename Func>
+inline void parallelTransformPixels(const Plane<S> &source, Plane<T> &target, Func &&func)
+{
+    int width = source.width();
+    parallelRows(source, target, [width, &func](int, const S *in, T *out) {
+        for (int x = 0; x < width; x++)
+        {
+            out[x] = func(in[x]);
+        }
+    });
+}
+
+} // namespace imagecore
+
+#endif
@@ -0,0 +1,191 @@
+#include "lut.h"
+
+#include <limits>
+#include <vector>
+
+#include "cpu.h"
+#include "iterate.h"
+
+#ifdef IMAGECORE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace imagecore
+{
+
+Lut identityLut()
+{
+    Lut lut;
+    for (int i = 0; i < GRAY_SPECTRUM; i++)
+    {
+        lut[i] = i;
+    }
+    return lut;
+}
+
+// the row kernels take the table widened to int32, which is what the AVX2 gathers load
+typedef std::array<int32_t, GRAY_SPECTRUM> WideLut;
+
+static WideLut widen(const Lut &lut, int min, int max)
+{
+    WideLut table;
+    for (int i = 0; i < GRAY_SPECTRUM; i++)
+    {
+        table[i] = clamp(lut[i], min, max);
+    }
+    return table;
+}
+
+static void applyLutRowScalar(const int32_t *table, const int16_t *in, int16_t *out, int width)
+{
+    for (int x = 0; x < width; x++)
+    {
+        out[x] = table[clamp(in[x], 0, GRAY_SPECTRUM - 1)];
+    }
+}
+
+static void applyChannelLutRowScalar(const int32_t *table, const Rgb *in, Rgb *out, int width)
+{
+    for (int x = 0; x < width; x++)
+    {
+        Rgb color = in[x];
+        out[x] = rgb(table[red(color)], table[green(color)], table[blue(color)]);
+    }
+}
+
+#ifdef IMAGECORE_X86_SIMD
+
+IMAGECORE_TARGET_AVX2 static void applyLutRowAVX2(const int32_t *table, const int16_t *in, int16_t *out, int width)
+{
+    const __m256i min = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi16(GRAY_SPECTRUM - 1);
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + x));
+        index = _mm256_min_epi16(_mm256_max_epi16(index, min), max);
+        __m256i lo = _mm256_i32gather_epi32(table, _mm256_cvtepi16_epi32(_mm256_castsi256_si128(index)), 4);
+        __m256i hi = _mm256_i32gather_epi32(table, _mm256_cvtepi16_epi32(_mm256_extracti128_si256(index, 1)), 4);
+        __m256i values = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x), values);
+    }
+    applyLutRowScalar(table, in + x, out + x, width - x);
+}
+
+IMAGECORE_TARGET_AVX2 static void applyChannelLutRowAVX2(const int32_t *table, const Rgb *in, Rgb *out, int width)
+{
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    const __m256i alpha = _mm256_set1_epi32(0xff000000);
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m256i color = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + x));
+        __m256i r = _mm256_i32gather_epi32(table, _mm256_and_si256(_mm256_srli_epi32(color, 16), mask), 4);
+        __m256i g = _mm256_i32gather_epi32(table, _mm256_and_si256(_mm256_srli_epi32(color, 8), mask), 4);
+        __m256i b = _mm256_i32gather_epi32(table, _mm256_and_si256(color, mask), 4);
+        __m256i result = _mm256_or_si256(_mm256_or_si256(alpha, _mm256_slli_epi32(r, 16)), _mm256_or_si256(_mm256_slli_epi32(g, 8), b));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x), result);
+    }
+    applyChannelLutRowScalar(table, in + x, out + x, width - x);
+}
+
+#endif
+
+static void applyLutRow(const WideLut &table, const int16_t *in, int16_t *out, int width)
+{
+#ifdef IMAGECORE_X86_SIMD
+    if (simdLevel() >= SimdLevel::AVX2)
+    {
+        applyLutRowAVX2(table.data(), in, out, width);
+        return;
+    }
+#endif
+    applyLutRowScalar(table.data(), in, out, width);
+}
+
+static void applyChannelLutRow(const WideLut &table, const Rgb *in, Rgb *out, int width)
+{
+#ifdef IMAGECORE_X86_SIMD
+    if (simdLevel() >= SimdLevel::AVX2)
+    {
+        applyChannelLutRowAVX2(table.data(), in, out, width);
+        return;
+    }
+#endif
+    applyChannelLutRowScalar(table.data(), in, out, width);
+}
+
+void applyLut(const Lut &lut, const LumaPlane &source, LumaPlane &target)
+{
+    int width = source.width();
+    WideLut table = widen(lut, std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max());
+    parallelRows(source, target, [&table, width](int, const int16_t *in, int16_t *out) {
+        applyLutRow(table, in, out, width);
+    });
+}
+
+LumaPlane applyLut(const Lut &lut, const LumaPlane &source)
+{
+    LumaPlane target(source.width(), source.height());
+    applyLut(lut, source, target);
+    return target;
+}
+
+void applyChannelLut(const Lut &lut, const Image &source, Image &target)
+{
+    int width = source.width();
+    WideLut table = widen(lut, 0, GRAY_SPECTRUM - 1);
+    parallelRows(source, target, [&table, width](int, const Rgb *in, Rgb *out) {
+        applyChannelLutRow(table, in, out, width);
+    });
+}
+
+void applyLuts(const Lut &lumaLut, const Lut &channelLut, const YCbCrImage &source, Image &target)
+{
+    int width = source.y.width();
+    bool hasLumaLut = lumaLut != identityLut();
+    bool hasChannelLut = channelLut != identityLut();
+    WideLut lumaTable = widen(lumaLut, std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max());
+    WideLut channelTable = widen(channelLut, 0, GRAY_SPECTRUM - 1);
+    parallelBands(width, source.y.height(), [&](int begin, int end) {
+        // the intermediate luma row stays in the cache, so every pixel is read and written once
+        std::vector<int16_t> luma(width);
+        for (int y = begin; y < end; y++)
+        {
+            const int16_t *lumaRow = source.y.row(y);
+            if (hasLumaLut)
+            {
+                applyLutRow(lumaTable, lumaRow, luma.data(), width);
+                lumaRow = luma.data();
+            }
+            Rgb *out = target.row(y);
+            yCbCrToRgbRow(lumaRow, source.cb.row(y), source.cr.row(y), out, width);
+            if (hasChannelLut)
+            {
+                applyChannelLutRow(channelTable, out, out, width);
+            }
+        }
+    });
+}
+
+Lut composeLuts(const Lut &first, const Lut &second)
+{
+    Lut lut;
+    for (int i = 0; i < GRAY_SPECTRUM; i++)
+    {
+        lut[i] = second[clamp(first[i], 0, GRAY_SPECTRUM - 1)];
+    }
+    return lut;
+}
+
+Histogram mapHistogram(const Histogram &hist, const Lut &lut)
+{
+    Histogram mapped = {0};
+    for (int i = 0; i < GRAY_SPECTRUM; i++)
+    {
+        mapped[clamp(lut[i], 0, GRAY_SPECTRUM - 1)] += hist[i];
+    }
+    return mapped;
+}
+
+} // namespace imagecore
@@ -0,0 +1,39 @@
+#ifndef IMAGECORE_LUT_H
+#define IMAGECORE_LUT_H
+
+#include <array>
+#include <cstdint>
+
+#include "color.h"
+#include "image.h"
+
+/*
+ * Point operations as lookup tables. A table maps every 8 bit input to its
+ * result, so an operation costs one table build plus one lookup pass over
+ * the pixels, vectorized with AVX2 gathers when available.
+ */
+
+namespace imagecore
+{
+
+typedef std::array<int16_t, GRAY_SPECTRUM> Lut;
+
+Lut identityLut();
+
+// looks up every luma value, values outside 0..255 are clamped to the table first
+void applyLut(const Lut &lut, const LumaPlane &source, LumaPlane &target);
+LumaPlane applyLut(const Lut &lut, const LumaPlane &source);
+// looks up each color channel, results are clamped to 0..255
+void applyChannelLut(const Lut &lut, const Image &source, Image &target);
+// looks up the luma, converts to RGB and looks up each channel in one pass over the pixels
+void applyLuts(const Lut &lumaLut, const Lut &channelLut, const YCbCrImage &source, Image &target);
+
+// table that applies first and then second, the same as two lookup passes
+Lut composeLuts(const Lut &first, const Lut &second);
+
+// histogram after applying lut to an image with histogram hist, results are clamped to 0..255
+Histogram mapHistogram(const Histogram &hist, const Lut &lut);
+
+} // namespace imagecore
+
+#endif
@@ -0,0 +1,351 @@
+#include "operations.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "color.h"
+#include "iterate.h"
+#include "lut.h"
+
+namespace imagecore
+{
+
+// consecutive pixels count into different copies of a histogram, so runs of equal values do not wait on the
+// increment of the previous pixel
+static const int HISTOGRAM_COPIES = 4;
+
+// counts of one band, every histogram starts on its own cache line
+template <int CHANNELS>
+struct alignas(64) SubHistograms
+{
+    uint32_t counts[CHANNELS][HISTOGRAM_COPIES][GRAY_SPECTRUM] = {};
+};
+
+// calls func(x, copy) for the pixels of a row, unrolled over the copies
+template <typename Func>
+static inline void forEachCopy(int width, Func &&func)
+{
+    int x = 0;
+    for (; x + HISTOGRAM_COPIES <= width; x += HISTOGRAM_COPIES)
+    {
+        for (int copy = 0; copy < HISTOGRAM_COPIES; copy++)
+        {
+            func(x + copy, copy);
+        }
+    }
+    for (; x < width; x++)
+    {
+        func(x, x - width / HISTOGRAM_COPIES * HISTOGRAM_COPIES);
+    }
+}
+
+// adds the copies of every channel to hists, bands finishing at the same time merge one after the other
+template <int CHANNELS>
+static void mergeSubHistograms(const SubHistograms<CHANNELS> &sub, Histogram *hists, std::mutex &mutex)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int c = 0; c < CHANNELS; c++)
+    {
+        for (int k = 0; k < GRAY_SPECTRUM; k++)
+        {
+            int count = 0;
+            for (int copy = 0; copy < HISTOGRAM_COPIES; copy++)
+            {
+                count += sub.counts[c][copy][k];
+            }
+            hists[c][k] += count;
+        }
+    }
+}
+
+// histograms of the luma (channel 0) and with four channels also of red, green and blue, in parallel bands
+template <int CHANNELS>
+static void countPixels(const Image &image, Histogram *hists)
+{
+    int width = image.width();
+    std::mutex mutex;
+    parallelBands(width, image.height(), [&image, hists, width, &mutex](int begin, int end) {
+        auto sub = std::make_unique<SubHistograms<CHANNELS>>();
+        std::vector<int16_t> gray(width);
+        for (int y = begin; y < end; y++)
+        {
+            const Rgb *line = image.row(y);
+            rgbToYCbCrRow(line, gray.data(), nullptr, nullptr, width);
+            forEachCopy(width, [&sub, &gray, line](int x, int copy) {
+                sub->counts[0][copy][gray[x]]++;
+                if constexpr (CHANNELS == 4)
+                {
+                    sub->counts[1][copy][red(line[x])]++;
+                    sub->counts[2][copy][green(line[x])]++;
+                    sub->counts[3][copy][blue(line[x])]++;
+                }
+            });
+        }
+        mergeSubHistograms(*sub, hists, mutex);
+    });
+}
+
+Histogram createHistogram(const Image &image)
+{
+    Histogram hist = {0};
+    countPixels<1>(image, &hist);
+    return hist;
+}
+
+Histogram createHistogram(const LumaPlane &luma)
+{
+    Histogram hist = {0};
+    int width = luma.width();
+    std::mutex mutex;
+    parallelBands(width, luma.height(), [&luma, &hist, width, &mutex](int begin, int end) {
+        auto sub = std::make_unique<SubHistograms<1>>();
+        for (int y = begin; y < end; y++)
+        {
+            const int16_t *line = luma.row(y);
+            // luma operations like the contrast may leave values outside of 0..255, they count as black or white
+            forEachCopy(width, [&sub, line](int x, int copy) {
+                sub->counts[0][copy][clamp(line[x], 0, GRAY_SPECTRUM - 1)]++;
+            });
+        }
+        mergeSubHistograms(*sub, &hist, mutex);
+    });
+    return hist;
+}
+
+ImageHistograms createHistograms(const Image &image)
+{
+    ImageHistograms histograms;
+    Histogram hists[4] = {};
+    countPixels<4>(image, hists);
+    histograms.luma = hists[0];
+    histograms.red = hists[1];
+    histograms.green = hists[2];
+    histograms.blue = hists[3];
+    histograms.statistics = calculateStatistics(histograms.luma);
+    return histograms;
+}
+
+int histogramPixelCount(const Histogram &hist)
+{
+    int MN = 0;
+    for (int k = 0; k < GRAY_SPECTRUM; k++)
+    {
+        MN += hist[k];
+    }
+    return MN;
+}
+
+ImageStatistics calculateStatistics(const Histogram &hist)
+{
+    int MN = histogramPixelCount(hist);
+
+    // calculate average
+    double avg = 0.0;
+    for (int k = 0; k < GRAY_SPECTRUM; k++)
+    {
+        avg += hist[k] * k;
+    }
+    avg /= MN;
+
+    // calculate variance
+    double var = 0.0;
+    for (int k = 0; k < GRAY_SPECTRUM; k++)
+    {
+        var += (hist[k] / (double)MN) * pow(k - avg, 2);
+    }
+    return ImageStatistics{avg, var};
+}
+
+Image toGrayscale(const Image &source)
+{
+    int width = source.width();
+    Image target(width, source.height());
+    parallelBands(width, source.height(), [&source, &target, width](int begin, int end) {
+        std::vector<int16_t> gray(width);
+        for (int y = begin; y < end; y++)
+        {
+            const Rgb *in = source.row(y);
+            Rgb *out = target.row(y);
+            rgbToYCbCrRow(in, gray.data(), nullptr, nullptr, width);
+            for (int x = 0; x < width; x++)
+            {
+                out[x] = rgb(gray[x], gray[x], gray[x]);
+            }
+        }
+    });
+    return target;
+}
+
+void drawCross(Image &target, const Image &original, int value)
+{
+    int size = std::min(target.width(), target.height());
+    int max_width = (int)(size * ((value + 1) / 100.0));
+    int offset = (int)((size - max_width) / 2.0);
+    for (int i = 0; i < size; i++)
+    {
+        int x_l = i;
+        int y_l = i;
+        int x_r = size - i - 1;
+        int y_r = i;
+
+        if (i > offset && i < offset + max_width)
+        {
+            target.setPixel(x_l, y_l, rgb(255, 0, 0));
+            target.setPixel(x_r, y_r, rgb(255, 0, 0));
+        }
+        else
+        {
+            target.setPixel(x_l, y_l, original.pixel(x_l, y_l));
+            target.setPixel(x_r, y_r, original.pixel(x_r, y_l));
+        }
+    }
+}
+
+Lut quantizationLut(int value)
+{
+    Lut lut = identityLut();
+    int div = pow(2, (8 - value));
+    if (div > 0)
+    {
+        for (int i = 0; i < GRAY_SPECTRUM; i++)
+        {
+            lut[i] = (i / div) * div;
+        }
+    }
+    return lut;
+}
+
+Lut brightnessLut(int value)
+{
+    Lut lut;
+    value = (int)((value / 100.0) * 255);
+    for (int i = 0; i < GRAY_SPECTRUM; i++)
+    {
+        int intensity = i + value;
+        lut[i] = intensity > 255 ? 255 : intensity;
+    }
+    return lut;
+}
+
+Lut contrastLut(const Histogram &hist, int value)
+{
+    Lut lut;
+    int middle = histogramPixelCount(hist) / 2;
+    int sum = 0;
+    int b = 0;
+    // find the middle
+    for (int i = 0; i < GRAY_SPECTRUM; i++)
+    {
+        sum += hist[i];
+        if (sum >= middle)
+        {
+            b = i;
+            break;
+        }
+    }
+    double factor = (value / 100.0) + 1;
+    for (int i = 0; i < GRAY_SPECTRUM; i++)
+    {
+        int intensity = (int)((i - b) * factor) + b;
+        lut[i] = toLuma(intensity > 255 ? 255 : intensity);
+    }
+    return lut;
+}
+
+Lut robustContrastLut(const Histogram &hist, int value)
+{
+    if (value == 0)
+    {
+        return identityLut();
+    }
+    Lut lut;
+    double factor = (value / 100.0) / 2;
+    int MN = histogramPixelCount(hist);
+    int n_a_low = MN * factor;
+    int n_a_high = MN * (1 - factor);
+    int a_low = 0;
+    int a_high = 0;
+    int sum = 0;
+    bool seenLow = false;
+    bool seenHigh = false;
+    for (int a = 0; a < GRAY_SPECTRUM; a++)
+    {
+        sum += hist[a];
+        if (sum >= n_a_low && !seenLow)
+        {
+            a_low = a;
+            seenLow = true;
+        }
+        if (sum >= n_a_high && !seenHigh)
+        {
+            a_high = a;
+            seenHigh = true;
+        }
+        if (seenLow && seenHigh)
+        {
+            break;
+        }
+    }
+    int a_min = 0;
+    int a_max = GRAY_SPECTRUM - 1;
+    double ratio = (a_max - a_min) / (double)(a_high - a_low);
+    for (int i = 0; i < GRAY_SPECTRUM; i++)
+    {
+        if (i <= a_low)
+        {
+            lut[i] = a_min;
+        }
+        else if (i >= a_high)
+        {
+            lut[i] = a_max;
+        }
+        else
+        {
+            lut[i] = (int)(a_min + (i - a_low) * ratio);
+        }
+    }
+    return lut;
+}
+
+Lut adjustmentLut(const Adjustments &adjustments, const Histogram &hist)
+{
+    // the contrast tables depend on the histogram of their input, so derive it from the tables so far
+    Lut lut = brightnessLut(adjustments.brightness);
+    lut = composeLuts(lut, contrastLut(mapHistogram(hist, lut), adjustments.contrast));
+    lut = composeLuts(lut, robustContrastLut(mapHistogram(hist, lut), adjustments.robustContrast));
+    return lut;
+}
+
+Image applyAdjustments(const Adjustments &adjustments, const YCbCrImage &source, const Histogram &hist)
+{
+    Image target(source.y.width(), source.y.height());
+    applyLuts(adjustmentLut(adjustments, hist), quantizationLut(adjustments.quantization), source, target);
+    return target;
+}
+
+Image quantizeImage(const Image &source, int value)
+{
+    Image target(source.width(), source.height());
+    applyChannelLut(quantizationLut(value), source, target);
+    return target;
+}
+
+LumaPlane changeBrightness(const LumaPlane &source, int value)
+{
+    return applyLut(brightnessLut(value), source);
+}
+
+LumaPlane changeContrast(const LumaPlane &source, const Histogram &hist, int value)
+{
+    return applyLut(contrastLut(hist, value), source);
+}
+
+LumaPlane changeRobustContrast(const LumaPlane &source, const Histogram &hist, int value)
+{
+    return applyLut(robustContrastLut(hist, value), source);
+}
+
+} // namespace imagecore
@@ -0,0 +1,67 @@
+#ifndef IMAGECORE_OPERATIONS_H
+#define IMAGECORE_OPERATIONS_H
+
+#include "color.h"
+#include "image.h"
+#include "lut.h"
+
+namespace imagecore
+{
+
+struct ImageStatistics
+{
+    double average;
+    double variance;
+};
+
+// histograms of the luma, counted in parallel bands; luma outside of 0..255 counts in the first or last bin
+Histogram createHistogram(const Image &image);
+Histogram createHistogram(const LumaPlane &luma);
+int histogramPixelCount(const Histogram &hist);
+ImageStatistics calculateStatistics(const Histogram &hist);
+
+// the luma and RGB histograms with the luma statistics of one pass over the pixels
+struct ImageHistograms
+{
+    Histogram luma;
+    Histogram red;
+    Histogram green;
+    Histogram blue;
+    ImageStatistics statistics;
+};
+
+ImageHistograms createHistograms(const Image &image);
+
+Image toGrayscale(const Image &source);
+void drawCross(Image &target, const Image &original, int value);
+Image quantizeImage(const Image &source, int value);
+
+// lookup tables of the point operations, the contrast tables take the histogram of the source
+Lut quantizationLut(int value);
+Lut brightnessLut(int value);
+Lut contrastLut(const Histogram &hist, int value);
+Lut robustContrastLut(const Histogram &hist, int value);
+
+// point operations that are shown together, the luma tables are applied in the
+// order brightness, contrast, robust contrast and quantization works on the RGB result
+struct Adjustments
+{
+    int brightness = 0;
+    int contrast = 0;
+    int robustContrast = 0;
+    int quantization = 8;
+};
+
+// composes the luma operations into one table, hist is the histogram of the unadjusted luma
+Lut adjustmentLut(const Adjustments &adjustments, const Histogram &hist);
+// renders source with all adjustments in one pass
+Image applyAdjustments(const Adjustments &adjustments, const YCbCrImage &source, const Histogram &hist);
+
+// luma operations, combine the result with the chroma of the source through toRgb()
+LumaPlane changeBrightness(const LumaPlane &source, int value);
+LumaPlane changeContrast(const LumaPlane &source, const Histogram &hist, int value);
+LumaPlane changeRobustContrast(const LumaPlane &source, const Histogram &hist, int value);
+
+} // namespace imagecore
+
+#endif
@@ -0,0 +1,246 @@
+#include "parallel.h"
+
+#include <algorithm>
+
+namespace imagecore
+{
+
+// set on the pool threads while they run a task, nested loops then run serially
+static thread_local bool insideTask = false;
+// flag of the innermost CancellationScope of the thread
+static thread_local const std::atomic<bool> *cancellation = nullptr;
+
+ThreadPool::ThreadPool(int threads)
+{
+    threads = std::max(threads, 1);
+    for (int i = 0; i < threads; i++)
+    {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 1; i < threads; i++)
+    {
+        workers.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+int ThreadPool::size() const
+{
+    return (int)queues.size();
+}
+
+void ThreadPool::run(int count, const std::function<void(int)> &func)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+    if (workers.empty() || insideTask || count == 1)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            func(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(runMutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &func;
+        remaining = count;
+        error = nullptr;
+    }
+    // contiguous blocks per thread keep neighbouring tiles on the same core
+    int threads = size();
+    for (int i = 0; i < threads; i++)
+    {
+        std::lock_guard<std::mutex> lock(queues[i]->mutex);
+        for (int t = (int)((int64_t)count * i / threads); t < (int)((int64_t)count * (i + 1) / threads); t++)
+        {
+            queues[i]->tasks.push_back(t);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation++;
+    }
+    wake.notify_all();
+
+    while (runNext(0))
+    {
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return remaining == 0; });
+    task = nullptr;
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::work(int index)
+{
+    uint64_t seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this, seen]() { return stopping || generation != seen; });
+            if (stopping)
+            {
+                return;
+            }
+            seen = generation;
+        }
+        while (runNext(index))
+        {
+        }
+    }
+}
+
+// runs one task from the own deque or stolen from another one, false if there is none left
+bool ThreadPool::runNext(int index)
+{
+    int threads = size();
+    int next = -1;
+    {
+        // the owner takes from the front, in the order the tiles lie in memory
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        if (!queues[index]->tasks.empty())
+        {
+            next = queues[index]->tasks.front();
+            queues[index]->tasks.pop_front();
+        }
+    }
+    for (int i = 1; next < 0 && i < threads; i++)
+    {
+        // thieves take from the back, as far away from the owner as possible
+        Queue &victim = *queues[(index + i) % threads];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            next = victim.tasks.back();
+            victim.tasks.pop_back();
+        }
+    }
+    if (next < 0)
+    {
+        return false;
+    }
+
+    // the task pointer was published before the tiles were queued
+    const std::function<void(int)> *func;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        func = task;
+    }
+    std::exception_ptr failure;
+    insideTask = true;
+    try
+    {
+        (*func)(next);
+    }
+    catch (...)
+    {
+        failure = std::current_exception();
+    }
+    insideTask = false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (failure && !error)
+    {
+        error = failure;
+    }
+    if (--remaining == 0)
+    {
+        done.notify_all();
+    }
+    return true;
+}
+
+static std::mutex poolMutex;
+static std::unique_ptr<ThreadPool> pool;
+
+static ThreadPool &threadPool()
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (!pool)
+    {
+        pool = std::make_unique<ThreadPool>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    return *pool;
+}
+
+int threadCount()
+{
+    return threadPool().size();
+}
+
+void setThreadCount(int count)
+{
+    if (count <= 0)
+    {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::lock_guard<std::mutex> lock(poolMutex);
+    pool.reset();
+    pool = std::make_unique<ThreadPool>(count);
+}
+
+static void throwIfCancelled(const std::atomic<bool> *cancelled)
+{
+    if (cancelled != nullptr && cancelled->load(std::memory_order_relaxed))
+    {
+        throw Cancelled();
+    }
+}
+
+void parallelFor(int count, int grain, const std::function<void(int, int)> &func)
+{
+    ThreadPool &threads = threadPool();
+    const std::atomic<bool> *cancelled = cancellation;
+    // a few tiles per thread leave room for stealing when they take unequal time
+    int tiles = std::min(count / std::max(grain, 1), threads.size() * 4);
+    if (tiles <= 1)
+    {
+        throwIfCancelled(cancelled);
+        func(0, count);
+        return;
+    }
+    threads.run(tiles, [count, tiles, cancelled, &func](int tile) {
+        // loops nested in the tile check the flag of the caller as well
+        CancellationScope scope(cancelled);
+        throwIfCancelled(cancelled);
+        func((int)((int64_t)count * tile / tiles), (int)((int64_t)count * (tile + 1) / tiles));
+    });
+}
+
+const char *Cancelled::what() const noexcept
+{
+    return "cancelled";
+}
+
+CancellationScope::CancellationScope(const std::atomic<bool> *cancelled) : previous(cancellation)
+{
+    cancellation = cancelled;
+}
+
+CancellationScope::~CancellationScope()
+{
+    cancellation = previous;
+}
+
+} // namespace imagecore
@@ -0,0 +1,98 @@
+#ifndef IMAGECORE_PARALLEL_H
+#define IMAGECORE_PARALLEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Persistent thread pool for the tile-parallel loops. A loop is split into
+ * tiles, every thread owns a deque of tiles and steals from the others once
+ * its own deque runs dry. Tiles never share output pixels and each pixel is
+ * computed by the same code as in a serial loop, so the results do not
+ * depend on the number of threads.
+ */
+
+namespace imagecore
+{
+
+class ThreadPool
+{
+public:
+    // threads includes the calling thread, so threads - 1 workers are started
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    int size() const;
+    // runs task(i) for every i in [0, count) and returns once all of them are done,
+    // the calling thread works on the tasks as well; calls from inside a task run serially
+    void run(int count, const std::function<void(int)> &task);
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+
+    void work(int index);
+    bool runNext(int index);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;
+    const std::function<void(int)> *task = nullptr;
+    int remaining = 0;
+    std::exception_ptr error;
+    uint64_t generation = 0;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    // one loop at a time, concurrent callers wait for their turn
+    std::mutex runMutex;
+};
+
+// threads used by the parallel loops, including the calling thread
+int threadCount();
+// 0 starts one thread per core, 1 runs every loop on the calling thread;
+// must not be called while a loop is running
+void setThreadCount(int count);
+
+// calls func(begin, end) for consecutive ranges that cover [0, count) in
+// parallel, every range except the last holds at least grain elements;
+// throws Cancelled instead of starting a range once the cancellation flag is set
+void parallelFor(int count, int grain, const std::function<void(int, int)> &func);
+
+// thrown out of the parallel loops of a cancelled computation
+class Cancelled : public std::exception
+{
+public:
+    const char *what() const noexcept override;
+};
+
+// makes cancelled the flag that the parallel loops started from the calling thread check before every range,
+// for the lifetime of the scope; nullptr runs them without a flag
+class CancellationScope
+{
+public:
+    explicit CancellationScope(const std::atomic<bool> *cancelled);
+    ~CancellationScope();
+    CancellationScope(const CancellationScope &) = delete;
+    CancellationScope &operator=(const CancellationScope &) = delete;
+
+private:
+    const std::atomic<bool> *previous;
+};
+
+} // namespace imagecore
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef IMAGECORE_PLANE_H
+#define IMAGECORE_PLANE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace imagecore
+{
+
+/*
+ * Single channel image plane in one contiguous allocation. Rows are stored
+ * one after another (row-major) and every row starts on a 64 byte boundary,
+ * so stride() can be larger than width(). Elements are addressed as (x, y).
+ */
+template <typename T>
+class Plane
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Plane elements are copied with memcpy");
+    static_assert(64 % sizeof(T) == 0, "rows could not be aligned to 64 bytes");
+
+public:
+    static const int Alignment = 64;
+
+    Plane() : w(0), h(0), s(0), buffer(nullptr)
+    {
+    }
+
+    Plane(int width, int height) : w(width), h(height), s(alignedStride(width)), buffer(allocate((size_t)s * height))
+    {
+    }
+
+    Plane(int width, int height, T value) : Plane(width, height)
+    {
+        fill(value);
+    }
+
+    Plane(const Plane &other) : Plane(other.w, other.h)
+    {
+        if (buffer != nullptr)
+        {
+            memcpy(buffer, other.buffer, (size_t)s * h * sizeof(T));
+        }
+    }
+
+    Plane(Plane &&other) noexcept : w(other.w), h(other.h), s(other.s), buffer(other.buffer)
+    {
+        other.w = other.h = other.s = 0;
+        other.buffer = nullptr;
+    }
+
+    ~Plane()
+    {
+        release(buffer);
+    }
+
+    Plane &operator=(Plane other) noexcept
+    {
+        std::swap(w, other.w);
+        std::swap(h, other.h);
+        std::swap(s, other.s);
+        std::swap(buffer, other.buffer);
+        return *this;
+    }
+
+    int width() const
+    {
+        return w;
+    }
+    int height() const
+    {
+        return h;
+    }
+    // distance between two rows in elements
+    int stride() const
+    {
+        return s;
+    }
+    bool isNull() const
+    {
+        return w == 0 || h == 0;
+    }
+
+    T *row(int y)
+    {
+        return buffer + (size_t)y * s;
+    }
+    const T *row(int y) const
+    {
+        return buffer + (size_t)y * s;
+    }
+    T *data()
+    {
+        return buffer;
+    }
+    const T *data() const
+    {
+        return buffer;
+    }
+
+    T &operator()(int x, int y)
+    {
+        return buffer[(size_t)y * s + x];
+    }
+    const T &operator()(int x, int y) const
+    {
+        return buffer[(size_t)y * s + x];
+    }
+
+    void fill(T value)
+    {
+        std::fill(buffer, buffer + (size_t)s * h, value);
+    }
+
+private:
+    static int alignedStride(int width)
+    {
+        int perAlignment = Alignment / sizeof(T);
+        return ((width + perAlignment - 1) / perAlignment) * perAlignment;
+    }
+
+    static T *allocate(size_t count)
+    {
+        if (count == 0)
+        {
+            return nullptr;
+        }
+        return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    static void release(T *pointer)
+    {
+        if (pointer != nullptr)
+        {
+            ::operator delete(pointer, std::align_val_t(Alignment));
+        }
+    }
+
+    int w;
+    int h;
+    int s;
+    T *buffer;
+};
+
+} // namespace imagecore
+
+#endif
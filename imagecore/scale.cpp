@@ -0,0 +1,74 @@
+#include "scale.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "iterate.h"
+
+namespace imagecore
+{
+
+int proxyFactor(int width, int height, int maxWidth, int maxHeight)
+{
+    maxWidth = std::max(maxWidth, 1);
+    maxHeight = std::max(maxHeight, 1);
+    return std::max({1, (width + maxWidth - 1) / maxWidth, (height + maxHeight - 1) / maxHeight});
+}
+
+template <typename T>
+static Plane<T> downsamplePlane(const Plane<T> &source, int factor)
+{
+    int width = source.width();
+    int height = source.height();
+    Plane<T> target((width + factor - 1) / factor, (height + factor - 1) / factor);
+    int targetWidth = target.width();
+    parallelBands(targetWidth, target.height(), [&source, &target, width, height, targetWidth, factor](int begin, int end) {
+        // column sums of the rows of one block, the block sums fit into an int for factors up to 2900
+        std::vector<int> columns(width);
+        for (int y = begin; y < end; y++)
+        {
+            int top = y * factor;
+            int bottom = std::min(top + factor, height);
+            std::fill(columns.begin(), columns.end(), 0);
+            for (int row = top; row < bottom; row++)
+            {
+                const T *in = source.row(row);
+                for (int x = 0; x < width; x++)
+                {
+                    columns[x] += in[x];
+                }
+            }
+            T *out = target.row(y);
+            for (int x = 0; x < targetWidth; x++)
+            {
+                int left = x * factor;
+                int right = std::min(left + factor, width);
+                int sum = 0;
+                for (int column = left; column < right; column++)
+                {
+                    sum += columns[column];
+                }
+                int count = (right - left) * (bottom - top);
+                out[x] = (T)((sum + count / 2) / count);
+            }
+        }
+    });
+    return target;
+}
+
+LumaPlane downsample(const LumaPlane &source, int factor)
+{
+    return downsamplePlane(source, factor);
+}
+
+Plane<uint8_t> downsample(const Plane<uint8_t> &source, int factor)
+{
+    return downsamplePlane(source, factor);
+}
+
+YCbCrImage downsample(const YCbCrImage &source, int factor)
+{
+    return YCbCrImage{downsample(source.y, factor), downsample(source.cb, factor), downsample(source.cr, factor)};
+}
+
+} // namespace imagecore
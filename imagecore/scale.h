@@ -0,0 +1,28 @@
+#ifndef IMAGECORE_SCALE_H
+#define IMAGECORE_SCALE_H
+
+#include "color.h"
+#include "plane.h"
+
+/*
+ * Proxies for progressive previews. A proxy shrinks the image by an integer
+ * factor with a box filter, so every proxy pixel is the mean of the block of
+ * pixels it covers. Operations with parameters in pixels, like the sigma of
+ * a Gaussian, take them divided by the factor on the proxy.
+ */
+
+namespace imagecore
+{
+
+// smallest factor that fits width x height into maxWidth x maxHeight, 1 if it fits already
+int proxyFactor(int width, int height, int maxWidth, int maxHeight);
+
+// rounded mean of every factor x factor block, blocks at the right and bottom edges
+// average the pixels inside the plane
+LumaPlane downsample(const LumaPlane &source, int factor);
+Plane<uint8_t> downsample(const Plane<uint8_t> &source, int factor);
+YCbCrImage downsample(const YCbCrImage &source, int factor);
+
+} // namespace imagecore
+
+#endif
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "imagecore.h"
+
+using namespace imagecore;
+
+static int failures = 0;
+
+static void check(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+template <typename T>
+static bool samePixels(const Plane<T> &a, const Plane<T> &b)
+{
+    if (a.width() != b.width() || a.height() != b.height())
+    {
+        return false;
+    }
+    for (int y = 0; y < a.height(); y++)
+    {
+        for (int x = 0; x < a.width(); x++)
+        {
+            if (a(x, y) != b(x, y))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// mirror border that sets the cancellation flag on its cancelAt-th call, a plain function so the stages cache it
+static std::atomic<bool> cancelled(false);
+static std::atomic<long> borderCalls(0);
+static long cancelAt = -1;
+
+static int cancellingBorder(int x, int y, const LumaPlane &image)
+{
+    if (++borderCalls == cancelAt)
+    {
+        cancelled = true;
+    }
+    return borderMirror(x, y, image);
+}
+
+static LumaPlane testLuma(int width, int height)
+{
+    std::mt19937 random(7);
+    LumaPlane luma(width, height);
+    iteratePixels(luma, [&luma, &random](int x, int y) {
+        luma(x, y) = ((x / 16 + y / 16) % 2) * 120 + random() % 80;
+    });
+    return luma;
+}
+
+// runs apply with the flag set once the calls of the blur are over, so it is cancelled partway through the stages
+// after the blur, returns whether it threw Cancelled
+template <typename Apply>
+static bool cancelAfterBlur(double sigma, const LumaPlane &source, Apply &&apply)
+{
+    borderCalls = 0;
+    applyGaussianFilter(sigma, source, cancellingBorder);
+    cancelAt = borderCalls + 1;
+    borderCalls = 0;
+    cancelled = false;
+    bool threw = false;
+    try
+    {
+        CancellationScope scope(&cancelled);
+        apply();
+    }
+    catch (const Cancelled &)
+    {
+        threw = true;
+    }
+    cancelAt = -1;
+    cancelled = false;
+    return threw;
+}
+
+static void usmStages(const LumaPlane &source)
+{
+    UsmStages stages;
+    stages.apply(source, 1, 1.0, 1.5, 2, cancellingBorder);
+    bool threw = cancelAfterBlur(2.0, source, [&]() { stages.apply(source, 1, 2.0, 1.5, 2, cancellingBorder); });
+    check(threw, "usm: apply is cancelled after the blur");
+
+    // the stages of sigma 1 are intact, those of sigma 2 are computed anew
+    check(samePixels(stages.apply(source, 1, 1.0, 0.5, 2, cancellingBorder), applyUsmAlgorithm(source, 1.0, 0.5, 2, cancellingBorder)),
+          "usm: stages of before the cancellation");
+    LumaPlane result = stages.apply(source, 1, 2.0, 0.5, 2, cancellingBorder);
+    check(!stages.wasReused(), "usm: cancelled stages are recomputed");
+    check(samePixels(result, applyUsmAlgorithm(source, 2.0, 0.5, 2, cancellingBorder)), "usm: stages after the cancellation");
+}
+
+static void cannyStages(const LumaPlane &source)
+{
+    CannyStages stages;
+    stages.apply(source, 1, 1.0, 2, 4, cancellingBorder);
+    bool threw = cancelAfterBlur(2.0, source, [&]() { stages.apply(source, 1, 2.0, 2, 4, cancellingBorder); });
+    check(threw, "canny: apply is cancelled after the blur");
+
+    check(samePixels<Rgb>(stages.apply(source, 1, 1.0, 1, 3, cancellingBorder), applyCannyAlgorithm(source, 1.0, 1, 3, cancellingBorder)),
+          "canny: stages of before the cancellation");
+    Image result = stages.apply(source, 1, 2.0, 1, 3, cancellingBorder);
+    check(!stages.wasReused(), "canny: cancelled stages are recomputed");
+    check(samePixels<Rgb>(result, applyCannyAlgorithm(source, 2.0, 1, 3, cancellingBorder)), "canny: stages after the cancellation");
+}
+
+// luma outside of 0..255, as the contrast leaves it, counts in the first and last bin
+static void histogramRange()
+{
+    LumaPlane luma(300, 200, 10);
+    luma(0, 0) = -50;
+    luma(1, 0) = 300;
+    luma(299, 199) = -32768;
+    Histogram hist = createHistogram(luma);
+    check(hist[0] == 2 && hist[255] == 1 && hist[10] == 300 * 200 - 3, "histogram: luma outside of 0..255 is clamped");
+}
+
+// largest difference of two planes
+static int maxDifference(const LumaPlane &a, const LumaPlane &b)
+{
+    int difference = 0;
+    iteratePixels(a, [&a, &b, &difference](int x, int y) {
+        difference = std::max(difference, std::abs(a(x, y) - b(x, y)));
+    });
+    return difference;
+}
+
+// an approximation by fewer separable terms stays within the error it logs, also where it is not cheaper
+static void approximationBound(const LumaPlane &source)
+{
+    Eigen::MatrixXd kernels[] = {Eigen::MatrixXd(5, 5), Eigen::MatrixXd(3, 3)};
+    kernels[0] << 1, 2, 3, 2, 1, 2, 5, 1, 5, 2, 3, 1, 9, 1, 3, 2, 5, 1, 5, 2, 1, 2, 3, 2, 1;
+    kernels[1] << 1, 2, 1, 2, -3, 2, 1, 2, 4;
+    int ranks[] = {1, 2};
+    for (int i = 0; i < 2; i++)
+    {
+        FilterOptions options;
+        options.borderStrategy = borderMirror;
+        LumaPlane exact = applyFilter(kernels[i], source, options);
+        options.approximationRank = ranks[i];
+        std::ostringstream log;
+        LumaPlane approximated = applyFilter(kernels[i], source, options, &log);
+        std::string text = log.str();
+        size_t at = text.find("Approximation error at most ");
+        check(at != std::string::npos, "approximation: the error bound is logged");
+        if (at != std::string::npos)
+        {
+            double bound = std::stod(text.substr(at + 28));
+            // both responses are truncated to whole gray levels
+            check(maxDifference(exact, approximated) <= bound + 1, "approximation: the error stays within the bound");
+        }
+    }
+}
+
+// an all-zero kernel, which the filter table allows, gives black instead of dividing by a zero weight
+static void zeroFilter(const LumaPlane &source)
+{
+    FilterOptions options;
+    options.borderStrategy = borderMirror;
+    for (int size : {3, 33})
+    {
+        LumaPlane result = applyFilter(Eigen::MatrixXd::Zero(size, size), source, options);
+        check(samePixels(result, LumaPlane(source.width(), source.height(), 0)), "zero filter: the response is black");
+    }
+}
+
+// a job that throws something else than Cancelled is reported, and the worker goes on with the next job
+static void workerFailure()
+{
+    std::string reported;
+    std::atomic<bool> started(false);
+    std::atomic<bool> ran(false);
+    {
+        LatestWorker worker([&reported](const std::string &message) { reported = message; });
+        worker.submit([&started]() {
+            started = true;
+            throw std::bad_alloc();
+        });
+        // submitted once the failing job runs, so it does not replace it
+        while (!started)
+        {
+            std::this_thread::yield();
+        }
+        worker.submit([&ran]() { ran = true; });
+        while (!ran)
+        {
+            std::this_thread::yield();
+        }
+    }
+    check(reported == std::bad_alloc().what(), "worker: the failure of a job is reported");
+    check(ran, "worker: the job after a failed one runs");
+}
+
+int main()
+{
+    // one thread runs the tiles in order, so the flag stops the same tile every time
+    setThreadCount(1);
+    LumaPlane source = testLuma(256, 256);
+    usmStages(source);
+    cannyStages(source);
+    histogramRange();
+    approximationBound(source);
+    zeroFilter(source);
+    workerFailure();
+    printf("%d failed\n", failures);
+    return failures;
+}
@@ -0,0 +1,8 @@
+# checks of the image processing core, exits with the number of failed checks
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt app_bundle
+
+include(../imagecore.pri)
+
+SOURCES += main.cpp
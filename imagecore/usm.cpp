@@ -0,0 +1,77 @@
+#include "usm.h"
+
+#include <utility>
+
+#include "color.h"
+#include "iterate.h"
+
+namespace imagecore
+{
+
+// blurred luma and the gradient magnitude of it, everything that depends on sigma
+static void blurStages(const LumaPlane &source, double sigma, const BorderStrategy &borderStrategy, LumaPlane &blurred, Plane<float> &E_mag)
+{
+    blurred = applyGaussianFilter(sigma, source, borderStrategy);
+    E_mag = Plane<float>(source.width(), source.height());
+    gradient(blurred, borderStrategy, E_mag);
+}
+
+// adds sharpness times the detail mask where the edge magnitude exceeds t_c, in one pass
+static LumaPlane sharpen(const LumaPlane &source, const LumaPlane &blurred, const Plane<float> &E_mag, double sharpness, double t_c)
+{
+    int width = source.width();
+    LumaPlane target(width, source.height());
+    parallelRows(source, target, [&blurred, &E_mag, width, sharpness, t_c](int y, const int16_t *in, int16_t *out) {
+        const int16_t *blur = blurred.row(y);
+        const float *magnitude = E_mag.row(y);
+        for (int x = 0; x < width; x++)
+        {
+            int mask = in[x] - blur[x];
+            out[x] = magnitude[x] > t_c ? toLuma(in[x] + sharpness * mask) : in[x];
+        }
+    });
+    return target;
+}
+
+LumaPlane applyUsmAlgorithm(const LumaPlane &source, double sigma, double sharpness, double t_c, const BorderStrategy &borderStrategy)
+{
+    LumaPlane blurred;
+    Plane<float> E_mag;
+    blurStages(source, sigma, borderStrategy, blurred, E_mag);
+    return sharpen(source, blurred, E_mag, sharpness, t_c);
+}
+
+LumaPlane UsmStages::apply(const LumaPlane &source, uint64_t imageVersion, double sigma, double sharpness, double t_c, const BorderStrategy &borderStrategy)
+{
+    // only the builtin strategies can be compared, a custom one is never reused
+    auto border = borderStrategy.target<int (*)(int, int, const LumaPlane &)>();
+    reused = hasStages && border != nullptr && *border == stagesBorder && imageVersion == stagesVersion && sigma == stagesSigma;
+    if (!reused)
+    {
+        // a cancelled blur or gradient throws before the stages and their key change
+        LumaPlane newBlurred;
+        Plane<float> newMagnitude;
+        blurStages(source, sigma, borderStrategy, newBlurred, newMagnitude);
+        blurred = std::move(newBlurred);
+        E_mag = std::move(newMagnitude);
+        hasStages = border != nullptr;
+        stagesBorder = border != nullptr ? *border : nullptr;
+        stagesVersion = imageVersion;
+        stagesSigma = sigma;
+    }
+    return sharpen(source, blurred, E_mag, sharpness, t_c);
+}
+
+bool UsmStages::wasReused() const
+{
+    return reused;
+}
+
+void UsmStages::clear()
+{
+    hasStages = false;
+    blurred = LumaPlane();
+    E_mag = Plane<float>();
+}
+
+} // namespace imagecore
@@ -0,0 +1,39 @@
+#ifndef IMAGECORE_USM_H
+#define IMAGECORE_USM_H
+
+#include <cstdint>
+
+#include "filter.h"
+#include "image.h"
+
+namespace imagecore
+{
+
+// returns the sharpened luma
+LumaPlane applyUsmAlgorithm(const LumaPlane &source, double sigma, double sharpness, double t_c, const BorderStrategy &borderStrategy);
+
+// applyUsmAlgorithm() that keeps the blurred luma and its edge magnitude of the last image, sigma and border strategy,
+// so a change of only the sharpness or t_c is a single pass over the pixels; imageVersion must change whenever the
+// source does
+class UsmStages
+{
+public:
+    LumaPlane apply(const LumaPlane &source, uint64_t imageVersion, double sigma, double sharpness, double t_c, const BorderStrategy &borderStrategy);
+    // whether the last apply() skipped the blur and the gradient
+    bool wasReused() const;
+    void clear();
+
+private:
+    bool hasStages = false;
+    bool reused = false;
+    uint64_t stagesVersion = 0;
+    double stagesSigma = 0;
+    int (*stagesBorder)(int, int, const LumaPlane &) = nullptr;
+    // the detail mask is the source minus blurred
+    LumaPlane blurred;
+    Plane<float> E_mag;
+};
+
+} // namespace imagecore
+
+#endif
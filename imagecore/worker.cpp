@@ -0,0 +1,106 @@
+#include "worker.h"
+
+#include <exception>
+
+#include "parallel.h"
+
+namespace imagecore
+{
+
+LatestWorker::LatestWorker(std::function<void(const std::string &)> failed) : failed(std::move(failed)), thread(&LatestWorker::work, this)
+{
+}
+
+LatestWorker::~LatestWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        pending = nullptr;
+        cancelled = true;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+void LatestWorker::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = std::move(job);
+        if (running && preemptible)
+        {
+            cancelled = true;
+        }
+    }
+    wake.notify_all();
+}
+
+void LatestWorker::cancel()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    pending = nullptr;
+    cancelled = true;
+    idle.wait(lock, [this]() { return !running; });
+}
+
+void LatestWorker::allowPreemption()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    preemptible = true;
+    if (pending)
+    {
+        cancelled = true;
+    }
+}
+
+void LatestWorker::work()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        wake.wait(lock, [this]() { return stopping || pending; });
+        if (stopping)
+        {
+            return;
+        }
+        std::function<void()> job = std::move(pending);
+        pending = nullptr;
+        running = true;
+        preemptible = false;
+        cancelled = false;
+        lock.unlock();
+        // a failing job, e.g. out of memory for a large image, must not end the thread and with it the process
+        std::string failure;
+        bool hasFailed = false;
+        try
+        {
+            CancellationScope scope(&cancelled);
+            job();
+        }
+        catch (const Cancelled &)
+        {
+        }
+        catch (const std::exception &error)
+        {
+            failure = error.what();
+            hasFailed = true;
+        }
+        catch (...)
+        {
+            failure = "unknown error";
+            hasFailed = true;
+        }
+        // the job and everything it captured are released before cancel() returns
+        job = nullptr;
+        if (hasFailed && failed)
+        {
+            failed(failure);
+        }
+        lock.lock();
+        running = false;
+        idle.notify_all();
+    }
+}
+
+} // namespace imagecore
@@ -0,0 +1,61 @@
+#ifndef IMAGECORE_WORKER_H
+#define IMAGECORE_WORKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/*
+ * Background thread for interactive operations. Only the newest submitted
+ * job waits: submitting replaces a job that has not started yet, so a burst
+ * of parameter changes computes the parameters of the last one only, while
+ * the job that already runs finishes and shows an intermediate result.
+ * cancel() stops the running job at the next tile of its parallel loops,
+ * and so does submitting once the running job allowed preemption, e.g.
+ * after it has shown a preview and only refines it. A cancelled job unwinds
+ * with Cancelled from wherever it is, so state that outlives a job, like the
+ * cached stages, must only be replaced once its new value is complete.
+ * A job that fails with any other exception is dropped the same way, the
+ * worker hands its message to the failure handler and takes the next job.
+ */
+
+namespace imagecore
+{
+
+class LatestWorker
+{
+public:
+    // failed is called on the worker thread with the message of a job that threw something else than Cancelled
+    explicit LatestWorker(std::function<void(const std::string &)> failed = nullptr);
+    ~LatestWorker();
+    LatestWorker(const LatestWorker &) = delete;
+    LatestWorker &operator=(const LatestWorker &) = delete;
+
+    // job runs on the worker thread, its parallel loops throw Cancelled once it is cancelled
+    void submit(std::function<void()> job);
+    // drops the waiting job and cancels the running one, returns once no job runs any more
+    void cancel();
+    // called by the running job, from then on a submitted job cancels it instead of waiting for it
+    void allowPreemption();
+
+private:
+    void work();
+
+    std::function<void(const std::string &)> failed;
+    std::function<void()> pending;
+    bool running = false;
+    bool preemptible = false;
+    bool stopping = false;
+    std::atomic<bool> cancelled{false};
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::thread thread;
+};
+
+} // namespace imagecore
+
+#endif
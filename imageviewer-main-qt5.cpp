@@ -50,7 +50,12 @@ int main(int argc, char *argv[])
     QCommandLineParser commandLineParser;
     commandLineParser.addHelpOption();
     commandLineParser.addPositionalArgument(ImageViewer::tr("[file]"), ImageViewer::tr("Image file to open."));
+    QCommandLineOption threadsOption(QStringList() << "t" << "threads",
+                                     ImageViewer::tr("Threads used for image processing, 0 starts one per core."),
+                                     ImageViewer::tr("count"), "0");
+    commandLineParser.addOption(threadsOption);
     commandLineParser.process(QCoreApplication::arguments());
+    imagecore::setThreadCount(commandLineParser.value(threadsOption).toInt());
     ImageViewer imageViewer;
     if (!commandLineParser.positionalArguments().isEmpty()
         && !imageViewer.loadFile(commandLineParser.positionalArguments().front())) {
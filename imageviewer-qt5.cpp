@@ -5,14 +5,11 @@
 
 #include <QCheckBox>
 #include <QDoubleSpinBox>
-#include <QGraphicsScene>
-#include <QGraphicsView>
 #include <QGroupBox>
 #include <QHBoxLayout>
 #include <QRect>
 #include <QSlider>
 #include <QSpinBox>
-#include <QStackedLayout>
 #include <QTableWidget>
 #include <QWidget>
 
@@ -21,10 +18,14 @@
 #endif
 #include <iostream>
 #include <cmath>
+#include <cstring>
+#include <memory>
+#include <sstream>
 
 using namespace std;
 
 #include "imageviewer-qt5.h"
+#include "utils/QHistogramWidget.h"
 #include "utils/QUnevenIntSpinBox.h"
 
 #define DEFAULT_CROSS_SLIDER 49
@@ -35,6 +36,7 @@ using namespace std;
 #define DEFAULT_FILTER_INPUT 1
 #define DEFAULT_SIGMA_INPUT 1
 #define DEFAULT_DERIVATION_CHECKBOX Qt::Unchecked
+#define DEFAULT_APPROXIMATION_RANK 0
 #define DEFAULT_CANNY_SIGMA_INPUT 1.4
 #define DEFAULT_HYSTERESIS_LOW_INPUT 1.5
 #define DEFAULT_HYSTERESIS_HIGH_INPUT 3.0
@@ -49,25 +51,24 @@ using namespace std;
 #define MIN_TC_INPUT 0.2
 
 #define MAX_FILTER_INPUT 100
-#define MAX_SIGMA_INPUT 8.0
-#define MAX_FILTER_SIZE 13
+#define MAX_SIGMA_INPUT 64.0
+#define MAX_FILTER_SIZE 31
 #define MAX_HYSTERESIS_LOW_INPUT 9.0
 #define MAX_HYSTERESIS_HIGH_INPUT 10.0
 #define MAX_SHARPNESS_INPUT 4.0
 #define MAX_TC_INPUT 10.0
 
-#define HIST_SPACING 3
-#define HIST_PADDING 20
-
 ImageViewer::ImageViewer()
+    : renderWorker([this](const std::string &message) {
+          QString text = QString::fromStdString(message);
+          QMetaObject::invokeMethod(this, [this, text]() { renderFailed(text); }, Qt::QueuedConnection);
+      })
 {
     image = NULL;
     originalImage = NULL;
-    histogramChart = NULL;
-    histogramChartView = NULL;
     isDerivationFilter = DEFAULT_DERIVATION_CHECKBOX == Qt::Checked;
 
-    setBorderStrategy(borderPad);
+    setBorderStrategy(imagecore::borderPad);
     resize(1600, 600);
 
     startLogging();
@@ -94,7 +95,8 @@ bool ImageViewer::imageIsLoaded()
 
 void ImageViewer::imageChanged(QImage *image)
 {
-    updateImageInformation(image);
+    Q_UNUSED(image);
+    updateImageInformation();
     updateImageDisplay();
     renewLogging();
 }
@@ -103,10 +105,7 @@ void ImageViewer::applyExampleAlgorithmClicked()
 {
     if (imageIsLoaded())
     {
-        iteratePixels([this](int i, int j) {
-            image->setPixelColor(i, j, rgbToGrayColor(image->pixelColor(i, j)));
-        });
-        emit imageUpdated(image);
+        setImage(imagecore::toGrayscale(buffer));
         logFile << "transformed to grayscale" << std::endl;
         renewLogging();
     }
@@ -144,22 +143,22 @@ void ImageViewer::filterNChanged(int value)
 }
 void ImageViewer::borderStrategyChangedPad()
 {
-    setBorderStrategy(borderPad);
+    setBorderStrategy(imagecore::borderPad);
 }
 void ImageViewer::borderStrategyChangedConstant()
 {
-    setBorderStrategy(borderConstant);
+    setBorderStrategy(imagecore::borderConstant);
 }
 void ImageViewer::borderStrategyChangedMirror()
 {
-    setBorderStrategy(borderMirror);
+    setBorderStrategy(imagecore::borderMirror);
 }
 
 void ImageViewer::applyFilterClicked()
 {
 
     Eigen::MatrixXd filter = MatrixXd::Constant(filterTable->rowCount(), filterTable->columnCount(), 0);
-    iterateRect(filterTable->rowCount(), filterTable->columnCount(), [this, &filter](int i, int j) {
+    imagecore::iterateRect(filterTable->rowCount(), filterTable->columnCount(), [this, &filter](int i, int j) {
         QWidget *cellContent = filterTable->cellWidget(i, j);
         if (cellContent != NULL)
         {
@@ -173,9 +172,28 @@ void ImageViewer::applyFilterClicked()
     applyFilter(filter);
 }
 
+void ImageViewer::applyFilterFileClicked()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Open Filter"), QDir::currentPath(),
+                                                    tr("Filter files (*.txt *.filter);;All files (*)"));
+    if (fileName.isEmpty())
+    {
+        return;
+    }
+    std::ifstream in(fileName.toStdString());
+    std::optional<Eigen::MatrixXd> filter = imagecore::readFilter(in);
+    if (!filter)
+    {
+        QMessageBox::information(this, QGuiApplication::applicationDisplayName(),
+                                 tr("Cannot read a filter from %1.").arg(QDir::toNativeSeparators(fileName)));
+        return;
+    }
+    applyFilter(*filter);
+}
+
 void ImageViewer::applyGaussianFilterClicked()
 {
-    applyGaussianFilter(sigmaSpinBox->value(), originalImage, image);
+    applyGaussianFilter(sigmaSpinBox->value());
 }
 
 void ImageViewer::derivationFilterStateChanged(int state)
@@ -197,7 +215,7 @@ void ImageViewer::applyUsmAlgorithmClicked()
 
 // setters
 
-void ImageViewer::setBorderStrategy(std::function<QColor(int, int, QImage *)> strategy)
+void ImageViewer::setBorderStrategy(imagecore::BorderStrategy strategy)
 {
     borderStrategy = strategy;
 }
@@ -209,83 +227,44 @@ void ImageViewer::setIsDerivationFilter(bool state)
 
 // actions
 
-void ImageViewer::updateImageInformation(QImage *image)
+void ImageViewer::updateImageInformation()
 {
-    int MN = image->width() * image->height();
-
-    // create histogram
-    int hist[GRAY_SPECTRUM] = {0};
-    createHistogram(image, hist);
-
-    // calculate average
-    double avg = 0.0;
-    for (int k = 0; k < GRAY_SPECTRUM; k++)
+    // create histogram, the average and variance come from the same pass over the pixels; renders bring the
+    // histograms along, so the pixels are only counted here for operations that run on the GUI thread anyway
+    // and when the channels are switched on
+    imagecore::ImageStatistics statistics;
+    if (b_hist && !histogramWidget->showsChannels())
     {
-        avg += hist[k] * k;
+        statistics = imagecore::calculateStatistics(*b_hist);
+        histogramWidget->setHistogram(*b_hist);
     }
-    avg /= MN;
-
-    // calculate variance
-    double var = 0.0;
-    for (int k = 0; k < GRAY_SPECTRUM; k++)
-    {
-        var += (hist[k] / (double)MN) * pow(k - avg, 2);
-    }
-
-    // display values
-    averageInfo->setNum(avg);
-    varianceInfo->setNum(var);
-
-    // find max value to scale histogram
-    int max = 0;
-    for (int k = 0; k < GRAY_SPECTRUM; k++)
+    else
     {
-        if (hist[k] > max)
+        if (!b_histograms)
         {
-            max = hist[k];
+            b_histograms = imagecore::createHistograms(buffer);
+            b_hist = b_histograms->luma;
         }
+        statistics = b_histograms->statistics;
+        histogramWidget->setHistograms(b_histograms->luma, b_histograms->red, b_histograms->green, b_histograms->blue);
     }
 
-    // histogram
-    if (histogramChart != NULL)
-    {
-        // delete all bars if histogram already exists
-        for (auto &item : histogramChart->items())
-        {
-            histogramChart->removeItem(item);
-        }
-    }
-    else
-    {
-        histogramChart = new QGraphicsScene();
-        histogramChartView = new QGraphicsView(histogramChart);
-        // flip histogram for comfort
-        histogramChartView->scale(1, -1);
-        stack->addWidget(histogramChartView);
-        stack->setCurrentWidget(histogramChartView);
-    }
-    int width = histogramChartView->size().width();
-    int height = histogramChartView->size().height();
+    // display values
+    averageInfo->setNum(statistics.average);
+    varianceInfo->setNum(statistics.variance);
+}
 
-    int barWidth = (int)((width - GRAY_SPECTRUM * HIST_SPACING) / (double)GRAY_SPECTRUM) + 0.5;
-    int posX = 0.0;
-    for (int i = 0; i < GRAY_SPECTRUM; i++)
-    {
-        int barHeight = (int)((hist[i] / (double)max) * (height - HIST_PADDING)) + 0.5;
-        histogramChart->addRect(QRect(posX, 0, barWidth, barHeight));
-        posX += barWidth + HIST_SPACING;
-    }
+void ImageViewer::histogramCumulativeStateChanged(int state)
+{
+    histogramWidget->setShowCumulative(state == Qt::Checked);
 }
 
-void ImageViewer::createHistogram(QImage *image, int *hist)
+void ImageViewer::histogramChannelsStateChanged(int state)
 {
-    for (int i = 0; i < image->width(); i++)
+    histogramWidget->setShowChannels(state == Qt::Checked);
+    if (imageIsLoaded())
     {
-        for (int j = 0; j < image->height(); j++)
-        {
-            int val = rgbToGray(image->pixelColor(i, j));
-            hist[val] += 1;
-        }
+        updateImageInformation();
     }
 }
 
@@ -293,29 +272,10 @@ void ImageViewer::drawCross(int value)
 {
     if (imageIsLoaded())
     {
-        int size = std::min(image->width(), image->height());
-        int max_width = (int)(size * ((value + 1) / 100.0));
-        int offset = (int)((size - max_width) / 2.0);
-        for (int i = 0; i < size; i++)
-        {
-            int x_l = i;
-            int y_l = i;
-            int x_r = size - i - 1;
-            int y_r = i;
-
-            if (i > offset && i < offset + max_width)
-            {
-                image->setPixelColor(x_l, y_l, QColor(255, 0, 0));
-                image->setPixelColor(x_r, y_r, QColor(255, 0, 0));
-            }
-            else
-            {
-                image->setPixelColor(x_l, y_l, originalImage->pixelColor(x_l, y_l));
-                image->setPixelColor(x_r, y_r, originalImage->pixelColor(x_r, y_l));
-            }
-        }
+        imagecore::Image result = buffer;
+        imagecore::drawCross(result, originalBuffer, value);
         logFile << "drew red cross" << std::endl;
-        emit imageUpdated(image);
+        setImage(std::move(result));
     }
 }
 
@@ -323,20 +283,9 @@ void ImageViewer::quantizeImage(int value)
 {
     if (imageIsLoaded())
     {
-        int div = pow(2, (8 - value));
-        if (div > 0)
-        {
-            iteratePixels([this, div](int i, int j) {
-                QColor color = originalImage->pixelColor(i, j);
-                color.setRed((color.red() / div) * div);
-                color.setBlue((color.blue() / div) * div);
-                color.setGreen((color.green() / div) * div);
-                image->setPixelColor(i, j, color);
-            });
-        }
+        adjustments.quantization = value;
         logFile << "quantized to " << value << "-bit" << std::endl;
-        logFile << div << std::endl;
-        emit imageUpdated(image);
+        applyAdjustments();
     }
 }
 
@@ -344,43 +293,18 @@ void ImageViewer::changeBrightness(int value)
 {
     if (imageIsLoaded())
     {
-        value = (int)((value / 100.0) * 255);
-        iteratePixels([this, value](int i, int j) {
-            std::tuple<int, int, int> color = rgbToYCbCr(originalImage->pixelColor(i, j));
-            int intensity = std::get<0>(color) + value;
-            std::get<0>(color) = intensity > 255 ? 255 : intensity;
-            image->setPixelColor(i, j, yCbCrToRgb(color));
-        });
-        logFile << "added brightness of " << value << std::endl;
-        emit imageUpdated(image);
+        adjustments.brightness = value;
+        logFile << "added brightness of " << (int)((value / 100.0) * 255) << std::endl;
+        applyAdjustments();
     }
 }
 void ImageViewer::changeContrast(int value)
 {
     if (imageIsLoaded())
     {
-        int middle = (originalImage->width() * originalImage->height()) / 2;
-        int sum = 0;
-        int b = 0;
-        // find the middle
-        for (int i = 0; i < GRAY_SPECTRUM; i++)
-        {
-            sum += o_hist[i];
-            if (sum >= middle)
-            {
-                b = i;
-                break;
-            }
-        }
-        double factor = (value / 100.0) + 1;
-        iteratePixels([this, factor, b](int i, int j) {
-            std::tuple<int, int, int> color = rgbToYCbCr(originalImage->pixelColor(i, j));
-            int intensity = (int)((std::get<0>(color) - b) * factor) + b;
-            std::get<0>(color) = intensity > 255 ? 255 : intensity;
-            image->setPixelColor(i, j, yCbCrToRgb(color));
-        });
-        logFile << "changed contrast with factor of " << factor << std::endl;
-        emit imageUpdated(image);
+        adjustments.contrast = value;
+        logFile << "changed contrast with factor of " << (value / 100.0) + 1 << std::endl;
+        applyAdjustments();
     }
 }
 
@@ -388,61 +312,108 @@ void ImageViewer::changeRobustContrast(int value)
 {
     if (imageIsLoaded())
     {
-        if (value == 0)
+        adjustments.robustContrast = value;
+        logFile << "changed robust contrast with percentage of " << (value / 100.0) / 2 << std::endl;
+        applyAdjustments();
+    }
+}
+
+// renders the whole adjustment stack from the original in one pass on the worker thread
+void ImageViewer::applyAdjustments()
+{
+    imagecore::Adjustments values = adjustments;
+    imagecore::Histogram hist = o_hist;
+    renderProgressive([values, hist](const imagecore::YCbCrImage &planes, int scale) {
+        imagecore::Lut lut = imagecore::adjustmentLut(values, hist);
+        Rendered rendered;
+        rendered.image = imagecore::Image(planes.y.width(), planes.y.height());
+        imagecore::applyLuts(lut, imagecore::quantizationLut(values.quantization), planes, rendered.image);
+        // the luma histogram follows from the tables unless the quantization changes the RGB channels
+        if (scale == 1 && values.quantization >= DEFAULT_QUANTIZATION_SLIDER)
         {
-            return;
+            rendered.hist = imagecore::mapHistogram(hist, lut);
         }
-        double factor = (value / 100.0) / 2;
-        int MN = image->width() * image->height();
-        int n_a_low = MN * factor;
-        int n_a_high = MN * (1 - factor);
-        int a_low;
-        int a_high;
-        int sum = 0;
-        bool seenLow = false;
-        bool seenHigh = false;
-        for (int a = 0; a < GRAY_SPECTRUM; a++)
+        return rendered;
+    });
+}
+
+// renders on the worker thread and posts the image back to the GUI thread, with progressive previews first on a
+// proxy that fits into the viewport; while parameters change only the newest render waits, and a new one
+// cancels the refinement of the last once its proxy is shown
+void ImageViewer::renderProgressive(Render render)
+{
+    uint64_t generation = renderGeneration;
+    bool showsChannels = histogramWidget->showsChannels();
+    int scale = 1;
+    if (progressiveAct->isChecked())
+    {
+        QSize viewport = scrollArea->viewport()->size();
+        scale = imagecore::proxyFactor(originalBuffer.width(), originalBuffer.height(), viewport.width(), viewport.height());
+    }
+    renderWorker.submit([this, generation, scale, showsChannels, render]() {
+        if (scale > 1)
         {
-            sum += o_hist[a];
-            if (sum >= n_a_low && !seenLow)
+            if (proxyScale != scale)
             {
-                a_low = a;
-                seenLow = true;
-            }
-            if (sum >= n_a_high && !seenHigh)
-            {
-                a_high = a;
-                seenHigh = true;
-            }
-            if (seenLow && seenHigh)
-            {
-                break;
+                // assigned only once the downsampling is complete, a cancelled one leaves the old proxy and scale
+                proxyPlanes = imagecore::downsample(originalPlanes, scale);
+                proxyScale = scale;
+                proxyVersion++;
             }
+            auto proxy = std::make_shared<Rendered>(render(proxyPlanes, scale));
+            QMetaObject::invokeMethod(this, [this, generation, proxy]() {
+                if (generation == renderGeneration)
+                {
+                    showProxy(std::move(proxy->image));
+                }
+            }, Qt::QueuedConnection);
+            renderWorker.allowPreemption();
         }
-        int a_min = 0;
-        int a_max = GRAY_SPECTRUM - 1;
-        double ratio = (a_max - a_min) / (double)(a_high - a_low);
-        iteratePixels([this, a_low, a_high, ratio, a_min, a_max](int i, int j) {
-            std::tuple<int, int, int> color = rgbToYCbCr(originalImage->pixelColor(i, j));
-            int intensity = std::get<0>(color);
-            if (intensity <= a_low)
-            {
-                intensity = a_min;
-            }
-            else if (intensity >= a_high)
-            {
-                intensity = a_max;
-            }
-            else
+        auto result = std::make_shared<Rendered>(render(originalPlanes, 1));
+        // counted here, the GUI thread only draws the histograms it is handed
+        if (showsChannels)
+        {
+            result->histograms = imagecore::createHistograms(result->image);
+            result->hist = result->histograms->luma;
+        }
+        else if (!result->hist)
+        {
+            result->hist = imagecore::createHistogram(result->image);
+        }
+        QMetaObject::invokeMethod(this, [this, generation, result]() {
+            // a newer image replaced the source or the result in the meantime
+            if (generation == renderGeneration)
             {
-                intensity = a_min + (intensity - a_low) * ratio;
+                if (!result->log.empty())
+                {
+                    logFile << result->log << std::endl;
+                }
+                showImage(std::move(result->image), result->hist, std::move(result->histograms));
             }
-            std::get<0>(color) = intensity;
-            image->setPixelColor(i, j, yCbCrToRgb(color));
-        });
-        logFile << "changed robust contrast with percentage of " << factor << std::endl;
-        emit imageUpdated(image);
+        }, Qt::QueuedConnection);
+    });
+}
+
+// a render that failed, e.g. for lack of memory for a large image, leaves the last full resolution result
+void ImageViewer::renderFailed(const QString &message)
+{
+    if (!proxyBuffer.isNull())
+    {
+        // image refers to the pixels of the proxy until it is pointed back at the buffer
+        *image = toQImage(buffer);
+        proxyBuffer = imagecore::Image();
+        updateImageDisplay();
     }
+    logFile << "rendering failed: " << message.toStdString() << std::endl;
+    renewLogging();
+    QMessageBox::warning(this, QGuiApplication::applicationDisplayName(), tr("Rendering failed: %1").arg(message));
+}
+
+// drops the renders that are still running or waiting, their results would overwrite a newer image
+void ImageViewer::cancelRendering()
+{
+    renderWorker.cancel();
+    renderGeneration++;
 }
 
 void ImageViewer::changeFilterTableWidth(int value)
@@ -459,7 +430,7 @@ void ImageViewer::changeFilterTableHeight(int value)
 
 void ImageViewer::setFilterTableWidgets()
 {
-    iterateRect(filterTable->rowCount(), filterTable->columnCount(), [this](int i, int j) {
+    imagecore::iterateRect(filterTable->rowCount(), filterTable->columnCount(), [this](int i, int j) {
         QWidget *cellContent = filterTable->cellWidget(i, j);
         if (cellContent == NULL)
         {
@@ -472,74 +443,6 @@ void ImageViewer::setFilterTableWidgets()
     });
 }
 
-void ImageViewer::apply1DXFilter(QImage *source, Eigen::VectorXd H_x, std::function<void(int, int, double, double)> func)
-{
-    iteratePixels([this, source, H_x, func](int x, int y) {
-        int x_h = (int)(H_x.size()) / 2;
-        double total_x = 0;
-        double n = 0;
-        for (int i = 0; i < H_x.size(); i++)
-        {
-            QColor pixel = getFilterPixel(x - x_h + i, y, source);
-            int intensity = rgbToGray(pixel);
-            total_x += H_x(i) * intensity;
-            n += abs(H_x(i));
-        }
-        func(x, y, total_x, n);
-    });
-}
-
-void ImageViewer::apply1DYFilter(QImage *source, Eigen::VectorXd H_y, std::function<void(int, int, double, double)> func)
-{
-    iteratePixels([this, source, H_y, func](int x, int y) {
-        int y_h = (int)(H_y.size()) / 2;
-        double total_y = 0;
-        double n = 0;
-        for (int i = 0; i < H_y.size(); i++)
-        {
-            int y_pos = y - y_h + i;
-            QColor pixel = getFilterPixel(x, y_pos, source);
-            int intensity = rgbToGray(pixel);
-            total_y += H_y(i) * intensity;
-            n += abs(H_y(i));
-        }
-        func(x, y, total_y, n);
-    });
-}
-void ImageViewer::applySeparatedFilter(Eigen::VectorXd H_x, Eigen::VectorXd H_y, QImage *source, QImage *target)
-{
-    std::vector<std::vector<double>> buffer(image->width(), std::vector<double>(image->height(), 0));
-
-    // apply 1D filter x dimenstion
-    apply1DXFilter(source, H_x, [this, &buffer](int x, int y, double value, double n) {
-        buffer[x][y] = isDerivationFilter ? value : value / n;
-    });
-
-    // apply 1D filter y dimenstion
-    iteratePixels([this, source, target, H_y, buffer](int x, int y) {
-        int y_h = (int)(H_y.size()) / 2;
-        double n = 0;
-        double total_y = 0;
-        for (int i = 0; i < H_y.size(); i++)
-        {
-            int intensity;
-            int y_pos = y - y_h + i;
-            if (isOutOfRange(x, y_pos, source->width(), source->height()))
-            {
-                QColor pixel = borderStrategy(x, y_pos, source);
-                intensity = rgbToGray(pixel);
-            }
-            else
-            {
-                intensity = buffer[x][y_pos];
-            }
-            total_y += H_y(i) * intensity;
-            n += abs(H_y(i));
-        }
-        applyFilterValue(total_y, x, y, n, source, target);
-    });
-}
-
 void ImageViewer::applyFilter(Eigen::MatrixXd filter)
 {
 
@@ -548,140 +451,36 @@ void ImageViewer::applyFilter(Eigen::MatrixXd filter)
         logFile << "Applying this filter:" << endl
                 << filter << endl;
 
-        // check if separable using SVD
-        Eigen::JacobiSVD<Eigen::MatrixXd> svd(filter, Eigen::ComputeThinU | Eigen::ComputeThinV);
-        bool isSeparable = svd.rank() == 1;
-        std::function<int(int x, int y, QImage *image)> filterFunc;
-
-        if (isSeparable)
+        imagecore::FilterOptions options;
+        options.borderStrategy = borderStrategy;
+        options.isDerivationFilter = isDerivationFilter;
+        options.approximationRank = approximationRankSpinBox->value();
+        imagecore::LumaPlane result = imagecore::applyFilter(filter, originalPlanes.y, options, &logFile);
+        if (isDerivationFilter)
         {
-            // thanks to https://web.archive.org/web/20200804115435/https://bartwronski.com/2020/02/03/separate-your-filters-svd-and-low-rank-approximation-of-image-filters/
-            VectorXd H_x = svd.matrixV()(Eigen::all, 0) * sqrt(svd.singularValues()[0]);
-            VectorXd H_y = svd.matrixU()(Eigen::all, 0) * sqrt(svd.singularValues()[0]);
-            logFile << "Filter is separable!" << std::endl;
-            logFile << "H_x:" << endl
-                    << H_x << endl;
-            logFile << "H_y:" << endl
-                    << H_y << endl;
-            applySeparatedFilter(H_x, H_y, originalImage, image);
+            setImage(imagecore::grayToRgb(result));
         }
         else
         {
-            double n = 0.0;
-            iterateRect(filter.rows(), filter.cols(), [&filter, &n](int x, int y) {
-                n += abs(filter(x, y));
-            });
-            int x_h = (int)(filter.rows()) / 2;
-            int y_h = (int)(filter.cols()) / 2;
-            iteratePixels([this, x_h, y_h, filter, n](int x, int y) {
-                double value = 0;
-                for (int u = 0; u < filter.cols(); u++)
-                {
-                    for (int v = 0; v < filter.rows(); v++)
-                    {
-                        auto yCbCr = rgbToYCbCr(getFilterPixel(x - x_h + u, y - y_h + v, originalImage));
-                        value += filter(v, u) * std::get<0>(yCbCr);
-                    }
-                }
-                applyFilterValue(value, x, y, n, originalImage, image);
-            });
+            setLuma(result);
         }
-
-        emit imageUpdated(image);
-    }
-}
-
-void ImageViewer::applyGaussianFilter(double sigma, QImage *source, QImage *target)
-{
-    Eigen::VectorXd kernel = createGaussianKernel(sigma);
-    applySeparatedFilter(kernel, kernel, source, target);
-    logFile << "Applied gaussian filter with sigma = " << sigma << endl;
-    emit imageUpdated(target);
-}
-
-int ImageViewer::getOrientationSector(double &d_x, double &d_y)
-{
-    double pi_8 = M_PI / 8.0;
-    double _d_x = cos(pi_8) * d_x - sin(pi_8) * d_y;
-    double _d_y = sin(pi_8) * d_x + cos(pi_8) * d_y;
-
-    if (_d_y < 0)
-    {
-        _d_x = -_d_x;
-        _d_y = -_d_y;
-    }
-    if (_d_x >= 0 && _d_x >= _d_y)
-    {
-        return 0;
-    }
-    else if (_d_x >= 0 && _d_x < _d_y)
-    {
-        return 1;
-    }
-    else if (_d_x < 0 && -_d_x < _d_y)
-    {
-        return 2;
-    }
-    else
-    {
-        return 3;
-    }
-}
-
-bool ImageViewer::isLocalMax(std::vector<std::vector<double>> &E_mag, int &x, int &y, int &s_0, double &t_low)
-{
-    double m_c = E_mag[x][y];
-    if (m_c < t_low)
-    {
-        return false;
     }
-    double m_L;
-    double m_R;
-
-    switch (s_0)
-    {
-    case 0:
-        m_L = E_mag[x - 1][y];
-        m_R = E_mag[x + 1][y];
-        break;
-    case 1:
-        m_L = E_mag[x - 1][y - 1];
-        m_R = E_mag[x + 1][y + 1];
-        break;
-    case 2:
-        m_L = E_mag[x][y - 1];
-        m_R = E_mag[x][y - 1];
-        break;
-    case 3:
-        m_L = E_mag[x - 1][y + 1];
-        m_R = E_mag[x + 1][y - 1];
-        break;
-    }
-    return m_L <= m_c && m_c >= m_R;
 }
 
-void ImageViewer::traceAndThreshold(std::vector<std::vector<double>> &E_nms, std::vector<std::vector<bool>> &E_bin, int &x_0, int &y_0, double &t_low)
+void ImageViewer::applyGaussianFilter(double sigma)
 {
-    int M = E_bin[0].size();
-    int N = E_bin.size();
-
-    E_bin[x_0][y_0] = true;
-    int x_L = max(x_0 - 1, 0);
-    int x_R = max(x_0 + 1, N - 1);
-    int y_L = max(y_0 - 1, 0);
-    int y_R = max(y_0 + 1, M - 1);
-
-    for (auto &x : std::vector<int>{x_L, x_0, x_R})
+    if (imageIsLoaded())
     {
-        for (auto &y : std::vector<int>{y_L, y_0, y_R})
-        {
-            if (E_nms[x][y] >= t_low && E_bin[x][y] == 0)
-            {
-                traceAndThreshold(E_nms, E_bin, x, y, t_low);
-            }
-        }
+        imagecore::BorderStrategy border = borderStrategy;
+        renderProgressive([sigma, border](const imagecore::YCbCrImage &planes, int scale) {
+            Rendered rendered;
+            rendered.image = imagecore::toRgb(imagecore::applyGaussianFilter(sigma / scale, planes.y, border), planes);
+            std::ostringstream log;
+            log << "Applied gaussian filter with sigma = " << sigma;
+            rendered.log = log.str();
+            return rendered;
+        });
     }
-    return;
 }
 
 void ImageViewer::applyCannyAlgorithm()
@@ -693,290 +492,134 @@ void ImageViewer::applyCannyAlgorithm()
     double sigma = cannySigmaSpinBox->value();
     double t_low = hysteresisTLowSpinBox->value();
     double t_high = hysteresisTHighSpinBox->value();
-    std::vector<std::vector<double>> I_x(image->width(), std::vector<double>(image->height(), 0));
-    std::vector<std::vector<double>> I_y(image->width(), std::vector<double>(image->height(), 0));
-    std::vector<std::vector<double>> E_mag(image->width(), std::vector<double>(image->height(), 0));
-    std::vector<std::vector<double>> E_nms(image->width(), std::vector<double>(image->height(), 0));
-    std::vector<std::vector<bool>> E_bin(image->width(), std::vector<bool>(image->height(), false));
-
-    applyGaussianFilter(sigma, originalImage, image);
-    calculateGradient(I_x, I_y, E_mag);
-
-    for (int x = 1; x < image->width() - 1; x++)
-    {
-        for (int y = 1; y < image->height() - 1; y++)
+    imagecore::BorderStrategy border = borderStrategy;
+    uint64_t version = imageVersion;
+    renderProgressive([this, sigma, t_low, t_high, border, version](const imagecore::YCbCrImage &planes, int scale) {
+        // the proxy keeps its own stages, its gradients are steeper by the scale
+        imagecore::CannyStages &stages = scale > 1 ? cannyProxyStages : cannyStages;
+        Rendered rendered;
+        rendered.image = stages.apply(planes.y, scale > 1 ? proxyVersion : version, sigma / scale, t_low * scale, t_high * scale, border);
+        std::ostringstream log;
+        log << "Applied canny algorithm with sigma = " << sigma;
+        if (stages.wasReused())
         {
-            double d_x = I_x[x][y];
-            double d_y = I_y[x][y];
-            int s_0 = getOrientationSector(d_x, d_y);
-
-            if (isLocalMax(E_mag, x, y, s_0, t_low))
-            {
-                E_nms[x][y] = E_mag[x][y];
-            }
+            log << " (only the thresholds changed)";
         }
-    }
-    for (int x = 1; x < image->width() - 1; x++)
-    {
-        for (int y = 1; y < image->height() - 1; y++)
-        {
-            if (E_nms[x][y] >= t_high && E_bin[x][y] == false)
-            {
-                traceAndThreshold(E_nms, E_bin, x, y, t_low);
-            }
-        }
-    }
-    iteratePixels([this, E_bin](int x, int y) {
-        QColor color = E_bin[x][y] ? QColor(255, 255, 255) : QColor(0, 0, 0);
-        image->setPixelColor(x, y, color);
+        rendered.log = log.str();
+        return rendered;
     });
-    emit imageUpdated(image);
 }
 void ImageViewer::applyUsmAlgorithm()
 {
+    if (!imageIsLoaded())
+    {
+        return;
+    }
     double sigma = usmSigmaSpinBox->value();
     double sharpness = sharpnessSpinBox->value();
     double t_c = tCSpinBox->value();
-    std::vector<std::vector<int>> M(image->width(), std::vector<int>(image->height(), 0));
-
-    Eigen::VectorXd kernel = createGaussianKernel(sigma);
-    applySeparatedFilter(kernel, kernel, originalImage, image);
-
-    iteratePixels([this, &M](int x, int y) {
-        M[x][y] = rgbToGray(originalImage->pixelColor(x, y)) - rgbToGray(image->pixelColor(x, y));
-    });
-    std::vector<std::vector<double>> E_mag(image->width(), std::vector<double>(image->height(), 0));
-    gradient(E_mag);
-
-    iteratePixels([this, M, sharpness, E_mag, t_c](int x, int y) {
-        auto color = rgbToYCbCr(originalImage->pixelColor(x, y));
-        if (E_mag[x][y] > t_c)
+    imagecore::BorderStrategy border = borderStrategy;
+    uint64_t version = imageVersion;
+    renderProgressive([this, sigma, sharpness, t_c, border, version](const imagecore::YCbCrImage &planes, int scale) {
+        // the proxy keeps its own stages, its gradients are steeper by the scale
+        imagecore::UsmStages &stages = scale > 1 ? usmProxyStages : usmStages;
+        Rendered rendered;
+        imagecore::LumaPlane result = stages.apply(planes.y, scale > 1 ? proxyVersion : version, sigma / scale, sharpness, t_c * scale, border);
+        rendered.image = imagecore::toRgb(result, planes);
+        std::ostringstream log;
+        log << "Applied USM Algorithm with sigma = " << sigma << " and sharpness " << sharpness;
+        if (stages.wasReused())
         {
-            std::get<0>(color) = std::get<0>(color) + sharpness * M[x][y];
+            log << " (only the sharpness or t_c changed)";
         }
-        image->setPixelColor(x, y, yCbCrToRgb(color));
+        rendered.log = log.str();
+        return rendered;
     });
-    logFile << "Applied USM Algorithm with sigma = " << sigma << " and sharpness " << sharpness << std::endl;
-    emit imageUpdated(image);
 }
 
 // helpers
 
-int ImageViewer::rgbToGray(int red, int green, int blue)
-{
-    return (int)((16 + (1 / 256.0) * (65.738 * red + 129.057 * green + 25.064 * blue)));
-}
-int ImageViewer::rgbToGray(QColor color)
-{
-    return rgbToGray(color.red(), color.green(), color.blue());
-}
-
-std::tuple<int, int, int> ImageViewer::rgbToYCbCr(QColor rgb)
-{
-    return rgbToYCbCr(std::tuple<int, int, int>(rgb.red(), rgb.green(), rgb.blue()));
-}
-std::tuple<int, int, int> ImageViewer::rgbToYCbCr(std::tuple<int, int, int> rgb)
-{
-    int red = std::get<0>(rgb);
-    int green = std::get<1>(rgb);
-    int blue = std::get<2>(rgb);
-    return std::tuple<int, int, int>(
-        rgbToGray(red, green, blue),
-        128 + (int)((1 / 256.0) * (-37.945 * red + (-74.494) * green + 112.439 * blue)),
-        128 + (int)((1 / 256.0) * (112.439 * red + (-94.154) * green + (-18.285) * blue)));
-}
-QColor ImageViewer::yCbCrToRgb(std::tuple<int, int, int> value)
-{
-    int y = std::get<0>(value);
-    int cb = std::get<1>(value);
-    int cr = std::get<2>(value);
-    double yComponent = 298.082 * (y - 16);
-
-    int r = (int)((1 / 256.0) * (yComponent + 408.583 * (cr - 128)));
-    int g = (int)((1 / 256.0) * (yComponent + (-100.291) * (cb - 128) + (-208.120) * (cr - 128)));
-    int b = (int)((1 / 256.0) * (yComponent + 516.411 * (cb - 128)));
-
-    return QColor(
-        clamp(r, 0, GRAY_SPECTRUM - 1),
-        clamp(g, 0, GRAY_SPECTRUM - 1),
-        clamp(b, 0, GRAY_SPECTRUM - 1));
-}
-QColor ImageViewer::rgbToGrayColor(QColor color)
-{
-    int value = rgbToGray(color.red(), color.green(), color.blue());
-    return QColor(value, value, value);
-}
-
-void ImageViewer::iterateRect(int width, int height, std::function<void(int, int)> func)
-{
-    for (int i = 0; i < width; i++)
-    {
-        for (int j = 0; j < height; j++)
-        {
-            func(i, j);
-        }
-    }
-}
-
-void ImageViewer::iteratePixels(std::function<void(int, int)> func)
-{
-    iterateRect(image->width(), image->height(), func);
-}
-
-int ImageViewer::clamp(int value, int min, int max)
-{
-    if (value < min)
-    {
-        return min;
-    }
-    if (value > max)
-    {
-        return max;
-    }
-    return value;
-}
-
-Eigen::VectorXd ImageViewer::createGaussianKernel(double sigma)
-{
-    int center = (int)(sigma * 3.0);
-    Eigen::VectorXd h = Eigen::VectorXd(2 * center + 1);
-    double sigma2 = sigma * sigma;
-    for (int i = 0; i < h.size(); i++)
-    {
-        double r = center - i;
-        h[i] = (double)(exp(-0.5 * (r * r) / sigma2));
-    }
-    return h;
-}
-
-QColor ImageViewer::getFilterPixel(int x, int y, QImage *image)
+// image has to be in QImage::Format_RGB32, which loadFile guarantees
+imagecore::Image ImageViewer::toImageBuffer(const QImage &image)
 {
-    if (isOutOfRange(x, y, image->width(), image->height()))
+    imagecore::Image buffer(image.width(), image.height());
+    for (int y = 0; y < image.height(); y++)
     {
-        return borderStrategy(x, y, image);
+        memcpy(buffer.scanLine(y), image.constScanLine(y), image.width() * sizeof(imagecore::Rgb));
     }
-    return image->pixelColor(x, y);
+    return buffer;
 }
 
-bool ImageViewer::isOutOfRange(int x, int y, int width, int height)
+// the returned image shares the pixels of buffer, so buffer has to outlive it
+QImage ImageViewer::toQImage(const imagecore::Image &buffer)
 {
-    return x < 0 || y < 0 || x > width - 1 || y > height - 1;
+    return QImage(reinterpret_cast<const uchar *>(buffer.bits()), buffer.width(), buffer.height(), buffer.bytesPerLine(), QImage::Format_RGB32);
 }
 
-#pragma GCC diagnostic push
-// for common interface these variables are not used
-#pragma GCC diagnostic ignored "-Wunused-parameter"
-QColor ImageViewer::borderPad(int x, int y, QImage *image)
+/*
+ * PRIVATE
+ */
+void ImageViewer::setDefaults()
 {
-    return QColor(0, 0, 0);
+    crossSlider->blockSignals(true);
+    crossSlider->setValue(DEFAULT_CROSS_SLIDER);
+    crossSlider->blockSignals(false);
+    quantizationSlider->blockSignals(true);
+    quantizationSlider->setValue(DEFAULT_QUANTIZATION_SLIDER);
+    quantizationSlider->blockSignals(false);
+    brightnessSlider->blockSignals(true);
+    brightnessSlider->setValue(DEFAULT_BRIGHTNESS_SLIDER);
+    brightnessSlider->blockSignals(false);
+    contrastSlider->blockSignals(true);
+    contrastSlider->setValue(DEFAULT_CONTRAST_SLIDER);
+    contrastSlider->blockSignals(false);
+    robustContrastSlider->blockSignals(true);
+    robustContrastSlider->setValue(DEFAULT_BRIGHTNESS_SLIDER);
+    robustContrastSlider->blockSignals(false);
+    adjustments = imagecore::Adjustments();
 }
-#pragma GCC diagnostic pop
 
-QColor ImageViewer::borderConstant(int x, int y, QImage *image)
-{
-    if (x > image->width() - 1)
-    {
-        x = image->width() - 1;
-    }
-    else if (x < 0)
-    {
-        x = 0;
-    }
-    if (y > image->height() - 1)
-    {
-        y = image->height() - 1;
-    }
-    else if (y < 0)
-    {
-        y = 0;
-    }
-    return image->pixelColor(x, y);
-}
-QColor ImageViewer::borderMirror(int x, int y, QImage *image)
+void ImageViewer::resetImage()
 {
-    if (x > image->width() - 1)
-    {
-        int dist = x - image->width();
-        x = image->width() - 1 - dist;
-    }
-    else if (x < 0)
-    {
-        x = -x;
-    }
-    if (y > image->height() - 1)
-    {
-        int dist = y - image->height();
-        y = image->height() - 1 - dist;
-    }
-    else if (y < 0)
-    {
-        y = -y;
-    }
-    return image->pixelColor(x, y);
+    cancelRendering();
+    buffer = originalBuffer;
+    b_hist = o_hist;
+    b_histograms.reset();
+    *image = toQImage(buffer);
+    proxyBuffer = imagecore::Image();
 }
 
-void ImageViewer::applyFilterValue(double value, int x, int y, double n, QImage *source, QImage *target)
+void ImageViewer::setImage(imagecore::Image result, std::optional<imagecore::Histogram> hist)
 {
-    QColor newPixelValue;
-    if (isDerivationFilter)
-    {
-        value = clamp(value + 127, 0, GRAY_SPECTRUM - 1);
-        newPixelValue = QColor(value, value, value);
-    }
-    else
-    {
-        value /= n;
-        auto old_color = rgbToYCbCr(source->pixelColor(x, y));
-        std::get<0>(old_color) = value;
-        newPixelValue = yCbCrToRgb(old_color);
-    }
-    target->setPixelColor(x, y, newPixelValue);
+    cancelRendering();
+    showImage(std::move(result), hist);
 }
 
-void ImageViewer::gradient(std::vector<std::vector<double>> &E_mag)
+void ImageViewer::showImage(imagecore::Image result, std::optional<imagecore::Histogram> hist,
+                            std::optional<imagecore::ImageHistograms> histograms)
 {
-    std::vector<std::vector<double>> I_x(image->width(), std::vector<double>(image->height(), 0));
-    std::vector<std::vector<double>> I_y(image->width(), std::vector<double>(image->height(), 0));
-    calculateGradient(I_x, I_y, E_mag);
+    buffer = std::move(result);
+    b_hist = hist;
+    b_histograms = std::move(histograms);
+    *image = toQImage(buffer);
+    proxyBuffer = imagecore::Image();
+    emit imageUpdated(image);
 }
 
-void ImageViewer::calculateGradient(std::vector<std::vector<double>> &I_x, std::vector<std::vector<double>> &I_y, std::vector<std::vector<double>> &E_mag)
+// shows the proxy of a render until the full resolution result replaces it, the label scales it up
+void ImageViewer::showProxy(imagecore::Image proxy)
 {
-    Eigen::VectorXd gradient(3);
-    gradient[0] = -0.5;
-    gradient[1] = 0;
-    gradient[2] = 0.5;
-
-    apply1DXFilter(image, gradient, [&I_x](int x, int y, double value, double n) {
-        I_x[x][y] = value;
-    });
-    apply1DYFilter(image, gradient, [&I_y](int x, int y, double value, double n) {
-        I_y[x][y] = value;
-    });
-
-    iteratePixels([I_x, I_y, &E_mag](int x, int y) {
-        E_mag[x][y] = sqrt(pow(I_x[x][y], 2) + pow(I_y[x][y], 2));
-    });
+    proxyBuffer = std::move(proxy);
+    *image = toQImage(proxyBuffer);
+    updateImageDisplay();
 }
 
-/*
- * PRIVATE
- */
-void ImageViewer::setDefaults()
+// recombines the edited luma with the chroma of the original image for display
+void ImageViewer::setLuma(const imagecore::LumaPlane &luma, std::optional<imagecore::Histogram> hist)
 {
-    crossSlider->blockSignals(true);
-    crossSlider->setValue(DEFAULT_CROSS_SLIDER);
-    crossSlider->blockSignals(false);
-    quantizationSlider->blockSignals(true);
-    quantizationSlider->setValue(DEFAULT_QUANTIZATION_SLIDER);
-    quantizationSlider->blockSignals(false);
+    setImage(imagecore::toRgb(luma, originalPlanes), hist);
 }
 
-void ImageViewer::resetImage()
-{
-    delete image;
-    image = new QImage(originalImage->copy());
-}
 void ImageViewer::generateControlPanels()
 {
     /*
@@ -1066,7 +709,15 @@ void ImageViewer::generateControlPanels()
     robustContrastLayout->addWidget(new QLabel("Robust Contrast"));
     robustContrastLayout->addWidget(robustContrastSlider);
 
-    stack = new QStackedLayout();
+    histogramWidget = new QHistogramWidget();
+
+    QHBoxLayout *histogramOptionsLayout = new QHBoxLayout();
+    QCheckBox *histogramCumulativeCheckBox = new QCheckBox("Cumulative");
+    QObject::connect(histogramCumulativeCheckBox, SIGNAL(stateChanged(int)), SLOT(histogramCumulativeStateChanged(int)));
+    QCheckBox *histogramChannelsCheckBox = new QCheckBox("RGB channels");
+    QObject::connect(histogramChannelsCheckBox, SIGNAL(stateChanged(int)), SLOT(histogramChannelsStateChanged(int)));
+    histogramOptionsLayout->addWidget(histogramCumulativeCheckBox);
+    histogramOptionsLayout->addWidget(histogramChannelsCheckBox);
 
     m_option_layout2->addLayout(avg_info);
     m_option_layout2->addLayout(var_info);
@@ -1074,7 +725,8 @@ void ImageViewer::generateControlPanels()
     m_option_layout2->addLayout(brightnessLayout);
     m_option_layout2->addLayout(contrastLayout);
     m_option_layout2->addLayout(robustContrastLayout);
-    m_option_layout2->addLayout(stack);
+    m_option_layout2->addLayout(histogramOptionsLayout);
+    m_option_layout2->addWidget(histogramWidget);
 
     tabWidget->addTab(m_option_panel2, "2");
 
@@ -1138,14 +790,30 @@ void ImageViewer::generateControlPanels()
     isDerivationCheckBox->setCheckState(DEFAULT_DERIVATION_CHECKBOX);
     QObject::connect(isDerivationCheckBox, SIGNAL(stateChanged(int)), SLOT(derivationFilterStateChanged(int)));
 
+    // 0 applies the filter exactly, otherwise at most that many separable passes
+    QHBoxLayout *approximationRankLayout = new QHBoxLayout();
+    approximationRankSpinBox = new QSpinBox();
+    approximationRankSpinBox->setMinimum(0);
+    approximationRankSpinBox->setMaximum(MAX_FILTER_SIZE);
+    approximationRankSpinBox->setValue(DEFAULT_APPROXIMATION_RANK);
+    approximationRankSpinBox->setSpecialValueText(tr("exact"));
+    approximationRankLayout->addWidget(new QLabel("Approximation rank: "));
+    approximationRankLayout->addWidget(approximationRankSpinBox);
+
     applyFilterButton = new QPushButton("Apply filter");
     QObject::connect(applyFilterButton, SIGNAL(clicked()), SLOT(applyFilterClicked()));
 
+    // larger kernels than the table holds are read from a file
+    applyFilterFileButton = new QPushButton("Apply filter from file...");
+    QObject::connect(applyFilterFileButton, SIGNAL(clicked()), SLOT(applyFilterFileClicked()));
+
     filterLayout->addLayout(filterMInfo);
     filterLayout->addLayout(filterNInfo);
     filterLayout->addWidget(filterTable);
     filterLayout->addWidget(isDerivationCheckBox);
+    filterLayout->addLayout(approximationRankLayout);
     filterLayout->addWidget(applyFilterButton);
+    filterLayout->addWidget(applyFilterFileButton);
     filterGroup->setLayout(filterLayout);
 
     // gaussian filter
@@ -1365,6 +1033,13 @@ void ImageViewer::generateMainGui()
 
 bool ImageViewer::loadFile(const QString &fileName)
 {
+    // the worker reads the original planes
+    cancelRendering();
+    proxyBuffer = imagecore::Image();
+    proxyPlanes = imagecore::YCbCrImage();
+    proxyScale = 0;
+    cannyProxyStages.clear();
+    usmProxyStages.clear();
     if (image != NULL)
     {
         delete image;
@@ -1376,11 +1051,17 @@ bool ImageViewer::loadFile(const QString &fileName)
         originalImage = NULL;
     }
 
-    image = new QImage(fileName);
+    // all operations work on 32 bit RGB scanlines, so convert once here
+    image = new QImage(QImage(fileName).convertToFormat(QImage::Format_RGB32));
     originalImage = new QImage(image->copy());
 
     if (image->isNull())
     {
+        originalBuffer = imagecore::Image();
+        originalPlanes = imagecore::YCbCrImage();
+        buffer = imagecore::Image();
+        b_hist.reset();
+        b_histograms.reset();
         QMessageBox::information(this, QGuiApplication::applicationDisplayName(),
                                  tr("Cannot load %1.").arg(QDir::toNativeSeparators(fileName)));
         setWindowFilePath(QString());
@@ -1391,13 +1072,17 @@ bool ImageViewer::loadFile(const QString &fileName)
 
     scaleFactor = 1.0;
 
+    originalBuffer = toImageBuffer(*originalImage);
+    originalPlanes = imagecore::toYCbCr(originalBuffer);
+    imageVersion++;
+    cannyStages.clear();
+    usmStages.clear();
+    o_hist = imagecore::createHistogram(originalPlanes.y);
+    buffer = originalBuffer;
+    b_hist = o_hist;
+    b_histograms.reset();
+    *image = toQImage(buffer);
     emit imageUpdated(image);
-    // reset histogram
-    for (int i = 0; i < GRAY_SPECTRUM; i++)
-    {
-        o_hist[i] = 0;
-    }
-    createHistogram(originalImage, o_hist);
     setDefaults();
 
     printAct->setEnabled(true);
@@ -1461,7 +1146,10 @@ void ImageViewer::zoomOut()
 
 void ImageViewer::normalSize()
 {
-    imageLabel->adjustSize();
+    if (originalImage != NULL)
+    {
+        imageLabel->resize(originalImage->size());
+    }
     scaleFactor = 1.0;
 }
 
@@ -1523,6 +1211,10 @@ void ImageViewer::createActions()
     normalSizeAct->setEnabled(false);
     connect(normalSizeAct, SIGNAL(triggered()), this, SLOT(normalSize()));
 
+    progressiveAct = new QAction(tr("&Progressive Preview"), this);
+    progressiveAct->setCheckable(true);
+    progressiveAct->setChecked(true);
+
     fitToWindowAct = new QAction(tr("&Fit to Window"), this);
     fitToWindowAct->setEnabled(false);
     fitToWindowAct->setCheckable(true);
@@ -1550,6 +1242,7 @@ void ImageViewer::createMenus()
     viewMenu->addAction(normalSizeAct);
     viewMenu->addSeparator();
     viewMenu->addAction(fitToWindowAct);
+    viewMenu->addAction(progressiveAct);
 
     helpMenu = new QMenu(tr("&Help"), this);
     helpMenu->addAction(aboutAct);
@@ -1571,7 +1264,8 @@ void ImageViewer::scaleImage(double factor)
 {
     Q_ASSERT(imageLabel->pixmap());
     scaleFactor *= factor;
-    imageLabel->resize(scaleFactor * imageLabel->pixmap()->size());
+    // a proxy may be shown, so scale the size of the original
+    imageLabel->resize(scaleFactor * originalImage->size());
 
     adjustScrollBar(scrollArea->horizontalScrollBar(), factor);
     adjustScrollBar(scrollArea->verticalScrollBar(), factor);
@@ -1,32 +1,23 @@
 #ifndef IMAGEVIEWER_H
 #define IMAGEVIEWER_H
-#define GRAY_SPECTRUM 256
 
 #include <QMainWindow>
 #ifndef QT_NO_PRINTER
 #include <QPrinter>
 #endif
 
-// eigen library for matrix SVD
-#pragma GCC diagnostic push
-// -Wall didn't work for some reason
-#pragma GCC diagnostic ignored "-Wmisleading-indentation"
-#pragma GCC diagnostic ignored "-Wint-in-bool-context"
-#pragma GCC diagnostic ignored "-Wdeprecated-copy"
-#include "utils/Eigen/SVD"
-#include "utils/Eigen/Core"
-#pragma GCC diagnostic pop
+// headless processing core, pulls in eigen for the filter matrices
+#include "imagecore/imagecore.h"
 using namespace Eigen;
 
 #include "fstream"
 #include <functional>
-#include <tuple>
+#include <optional>
+#include <string>
 #include <vector>
 
 class QAction;
 class QDoubleSpinBox;
-class QGraphicsScene;
-class QGraphicsView;
 class QLabel;
 class QMenu;
 class QRect;
@@ -34,15 +25,14 @@ class QScrollArea;
 class QScrollBar;
 class QSlider;
 class QSpinBox;
-class QStackedLayout;
 class QTableWidget;
 class QTextEdit;
+class QHistogramWidget;
 class QUnevenIntSpinBox;
 class QVBoxLayout;
 class QTabWidget;
 class QPushButton;
 class QSpinBox;
-class QColor;
 
 class ImageViewer : public QMainWindow
 {
@@ -56,12 +46,15 @@ private slots:
     void brightnessSliderValueChanged(int value);
     void contrastSliderValueChanged(int value);
     void robustContrastSliderValueChanged(int value);
+    void histogramCumulativeStateChanged(int state);
+    void histogramChannelsStateChanged(int state);
     void filterMChanged(int value);
     void filterNChanged(int value);
     void borderStrategyChangedPad();
     void borderStrategyChangedConstant();
     void borderStrategyChangedMirror();
     void applyFilterClicked();
+    void applyFilterFileClicked();
     void applyGaussianFilterClicked();
     void derivationFilterStateChanged(int state);
     void applyCannyAlgorithmClicked();
@@ -85,11 +78,11 @@ public:
     bool imageIsLoaded();
 
     // setters
-    void setBorderStrategy(std::function<QColor(int, int, QImage *)> strategy);
+    void setBorderStrategy(imagecore::BorderStrategy strategy);
     void setIsDerivationFilter(bool state);
 
     // actions
-    void updateImageInformation(QImage *image);
+    void updateImageInformation();
     void quantizeImage(int value);
     void drawCross(int value);
     void changeBrightness(int value);
@@ -98,38 +91,14 @@ public:
     void changeFilterTableWidth(int value);
     void changeFilterTableHeight(int value);
     void setFilterTableWidgets();
-    void apply1DXFilter(QImage *source, Eigen::VectorXd H_x, std::function<void(int, int, double, double)> func);
-    void apply1DYFilter(QImage *source, Eigen::VectorXd H_y, std::function<void(int, int, double, double)> func);
-    void applySeparatedFilter(Eigen::VectorXd H_x, Eigen::VectorXd H_y, QImage *source, QImage *target);
     void applyFilter(Eigen::MatrixXd filter);
-    void applyGaussianFilter(double sigma, QImage *source, QImage *target);
-    void createHistogram(QImage *image, int *hist);
-    int getOrientationSector(double &d_x, double &d_y);
-    bool isLocalMax(std::vector<std::vector<double>> &E_mag, int &x, int &y, int &s_0, double &t_low);
-    void traceAndThreshold(std::vector<std::vector<double>> &E_nms, std::vector<std::vector<bool>> &E_bin, int &x, int &y, double &t_low);
+    void applyGaussianFilter(double sigma);
     void applyCannyAlgorithm();
     void applyUsmAlgorithm();
 
     // helpers
-    int rgbToGray(int red, int green, int blue);
-    int rgbToGray(QColor color);
-    QColor rgbToGrayColor(QColor color);
-    void iterateRect(int width, int height, std::function<void(int, int)> func);
-    void iteratePixels(std::function<void(int, int)> func);
-    std::tuple<int, int, int> rgbToYCbCr(std::tuple<int, int, int> rgb);
-    std::tuple<int, int, int> rgbToYCbCr(QColor rgb);
-    QColor yCbCrToRgb(std::tuple<int, int, int> val);
-    int clamp(int value, int min, int max);
-    Eigen::VectorXd createGaussianKernel(double sigma);
-    bool isOutOfRange(int x, int y, int width, int height);
-    QColor getFilterPixel(int i, int j, QImage *image);
-    void applyFilterValue(double value, int x, int y, double n, QImage *source, QImage *target);
-    void gradient(std::vector<std::vector<double>> &E_mag);
-    void calculateGradient(std::vector<std::vector<double>> &I_x, std::vector<std::vector<double>> &I_y, std::vector<std::vector<double>> &E_mag);
-
-    static QColor borderPad(int i, int j, QImage *image);
-    static QColor borderConstant(int i, int j, QImage *image);
-    static QColor borderMirror(int i, int j, QImage *image);
+    static imagecore::Image toImageBuffer(const QImage &image);
+    static QImage toQImage(const imagecore::Image &buffer);
 
 protected:
     void resizeEvent(QResizeEvent *event);
@@ -148,17 +117,59 @@ private:
     void scaleImage(double factor);
     void adjustScrollBar(QScrollBar *scrollBar, double factor);
     void renewLogging();
+    void setImage(imagecore::Image result, std::optional<imagecore::Histogram> hist = std::nullopt);
+    // setImage() without cancelling the renders
+    void showImage(imagecore::Image result, std::optional<imagecore::Histogram> hist,
+                   std::optional<imagecore::ImageHistograms> histograms = std::nullopt);
+    void showProxy(imagecore::Image proxy);
+    void cancelRendering();
+    void renderFailed(const QString &message);
+
+    // result of a render job, log is written once the full resolution image is shown; the histograms of the full
+    // resolution image are counted by renderProgressive() unless the render can derive them
+    struct Rendered
+    {
+        imagecore::Image image;
+        std::optional<imagecore::Histogram> hist;
+        std::optional<imagecore::ImageHistograms> histograms;
+        std::string log;
+    };
+    // renders planes that are shrunk by scale, with the parameters in pixels divided by it
+    typedef std::function<Rendered(const imagecore::YCbCrImage &planes, int scale)> Render;
+    void renderProgressive(Render render);
+    void setLuma(const imagecore::LumaPlane &luma, std::optional<imagecore::Histogram> hist = std::nullopt);
+    void applyAdjustments();
 
     // custom attributes
     QImage *originalImage;
-    int o_hist[GRAY_SPECTRUM] = {0};
+    imagecore::Image originalBuffer;
+    // decomposed once per loaded file, luma operations only replace its y plane
+    imagecore::YCbCrImage originalPlanes;
+    // counts the loaded files, keys the cached stages of the filters
+    uint64_t imageVersion = 0;
+    imagecore::CannyStages cannyStages;
+    imagecore::UsmStages usmStages;
+    // proxy of the original planes for progressive previews with its own stages, only used by the render jobs
+    imagecore::YCbCrImage proxyPlanes;
+    int proxyScale = 0;
+    uint64_t proxyVersion = 0;
+    imagecore::CannyStages cannyProxyStages;
+    imagecore::UsmStages usmProxyStages;
+    // shown while the full resolution result of a render is computed
+    imagecore::Image proxyBuffer;
+    imagecore::Image buffer;
+    imagecore::Histogram o_hist = {0};
+    // histogram of buffer if it is known without rescanning the pixels
+    std::optional<imagecore::Histogram> b_hist;
+    // histograms of the channels of buffer once they were counted
+    std::optional<imagecore::ImageHistograms> b_histograms;
+    // point operations of the sliders, rendered together by applyAdjustments()
+    imagecore::Adjustments adjustments;
     QSlider *crossSlider;
     QLabel *varianceInfo;
     QLabel *averageInfo;
-    QGraphicsScene *histogramChart;
-    QGraphicsView *histogramChartView;
+    QHistogramWidget *histogramWidget;
     QSlider *quantizationSlider;
-    QStackedLayout *stack;
     QSlider *brightnessSlider;
     QSlider *contrastSlider;
     QSlider *robustContrastSlider;
@@ -167,9 +178,11 @@ private:
     QTableWidget *filterTable;
     std::vector<std::vector<int>> *filter;
     QPushButton *applyFilterButton;
-    std::function<QColor(int, int, QImage *)> borderStrategy;
+    QPushButton *applyFilterFileButton;
+    imagecore::BorderStrategy borderStrategy;
     QDoubleSpinBox *sigmaSpinBox;
     bool isDerivationFilter;
+    QSpinBox *approximationRankSpinBox;
     QDoubleSpinBox *cannySigmaSpinBox;
     QDoubleSpinBox *hysteresisTLowSpinBox;
     QDoubleSpinBox *hysteresisTHighSpinBox;
@@ -208,12 +221,18 @@ private:
     QAction *zoomOutAct;
     QAction *normalSizeAct;
     QAction *fitToWindowAct;
+    QAction *progressiveAct;
     QAction *aboutAct;
     QAction *aboutQtAct;
 
     QMenu *fileMenu;
     QMenu *viewMenu;
     QMenu *helpMenu;
+
+    // renders the adjustments and the previewed operations, declared last so it stops before the images it
+    // reads are destroyed
+    uint64_t renderGeneration = 0;
+    imagecore::LatestWorker renderWorker;
 };
 
 #endif
@@ -1,11 +1,18 @@
 QT += widgets
 
+# the renders are posted back to the GUI thread with the functor overload of QMetaObject::invokeMethod()
+equals(QT_MAJOR_VERSION, 5):lessThan(QT_MINOR_VERSION, 10): error("Qt 5.10 or newer is required")
+
 qtHaveModule(printsupport): QT += printsupport
 
-HEADERS       = imageviewer-qt5.h \
+include(imagecore/imagecore.pri)
+
+HEADERS      += imageviewer-qt5.h \
+                utils/QHistogramWidget.h \
                 utils/QUnevenIntSpinBox.h
-SOURCES       = imageviewer-qt5.cpp \
+SOURCES      += imageviewer-qt5.cpp \
                 imageviewer-main-qt5.cpp \
+                utils/QHistogramWidget.cpp \
                 utils/QUnevenIntSpinBox.cpp
 
 # install
@@ -0,0 +1,112 @@
+#include "./QHistogramWidget.h"
+
+#include <QPainter>
+#include <QPointF>
+
+#include <algorithm>
+
+// space above the highest bar
+static const int HIST_PADDING = 20;
+
+QHistogramWidget::QHistogramWidget(QWidget *parent) : QWidget(parent)
+{
+    setMinimumHeight(100);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void QHistogramWidget::setHistogram(const imagecore::Histogram &luma)
+{
+    counts[0] = luma;
+    maxima[0] = *std::max_element(luma.begin(), luma.end());
+    qint64 sum = 0;
+    for (int k = 0; k < GRAY_SPECTRUM; k++)
+    {
+        sum += luma[k];
+        cumulative[k] = sum;
+    }
+    hasChannels = false;
+    update();
+}
+
+void QHistogramWidget::setHistograms(const imagecore::Histogram &luma, const imagecore::Histogram &red,
+                                     const imagecore::Histogram &green, const imagecore::Histogram &blue)
+{
+    setHistogram(luma);
+    counts[1] = red;
+    counts[2] = green;
+    counts[3] = blue;
+    for (int c = 1; c < 4; c++)
+    {
+        maxima[c] = *std::max_element(counts[c].begin(), counts[c].end());
+    }
+    hasChannels = true;
+}
+
+void QHistogramWidget::setShowCumulative(bool show)
+{
+    showCumulative = show;
+    update();
+}
+
+void QHistogramWidget::setShowChannels(bool show)
+{
+    showChannels = show;
+    update();
+}
+
+bool QHistogramWidget::showsChannels() const
+{
+    return showChannels;
+}
+
+void QHistogramWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().base());
+
+    double binWidth = width() / (double)GRAY_SPECTRUM;
+    double scale = height() - HIST_PADDING;
+    // bars are one pixel apart once they are wide enough for it
+    double gap = binWidth >= 3 ? 1 : 0;
+    if (maxima[0] > 0)
+    {
+        QColor barColor = palette().text().color();
+        for (int k = 0; k < GRAY_SPECTRUM; k++)
+        {
+            double barHeight = counts[0][k] / (double)maxima[0] * scale;
+            painter.fillRect(QRectF(k * binWidth, height() - barHeight, binWidth - gap, barHeight), barColor);
+        }
+    }
+
+    // curves through the centers of the bins
+    QPointF points[GRAY_SPECTRUM];
+    painter.setRenderHint(QPainter::Antialiasing);
+    if (showChannels && hasChannels)
+    {
+        static const Qt::GlobalColor CHANNEL_COLORS[3] = {Qt::red, Qt::green, Qt::blue};
+        for (int c = 1; c < 4; c++)
+        {
+            if (maxima[c] == 0)
+            {
+                continue;
+            }
+            for (int k = 0; k < GRAY_SPECTRUM; k++)
+            {
+                points[k] = QPointF((k + 0.5) * binWidth, height() - counts[c][k] / (double)maxima[c] * scale);
+            }
+            painter.setPen(QColor(CHANNEL_COLORS[c - 1]));
+            painter.drawPolyline(points, GRAY_SPECTRUM);
+        }
+    }
+    if (showCumulative && cumulative[GRAY_SPECTRUM - 1] > 0)
+    {
+        double total = cumulative[GRAY_SPECTRUM - 1];
+        for (int k = 0; k < GRAY_SPECTRUM; k++)
+        {
+            points[k] = QPointF((k + 0.5) * binWidth, height() - cumulative[k] / total * scale);
+        }
+        painter.setPen(QPen(palette().highlight().color(), 2));
+        painter.drawPolyline(points, GRAY_SPECTRUM);
+    }
+}
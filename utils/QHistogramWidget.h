@@ -0,0 +1,43 @@
+#ifndef QHISTOGRAMWIDGET_H
+#define QHISTOGRAMWIDGET_H
+
+#include <QWidget>
+
+#include <array>
+
+#include "../imagecore/image.h"
+
+/*
+ * Paints the luma histogram as bars straight from cached counts, optionally
+ * with the cumulative histogram and the red, green and blue histograms as
+ * curves on top. Setting new counts copies them into fixed arrays and only
+ * schedules a repaint, so updates allocate nothing and repaints coalesce to
+ * the display rate.
+ */
+class QHistogramWidget : public QWidget
+{
+public:
+    explicit QHistogramWidget(QWidget *parent = nullptr);
+
+    void setHistogram(const imagecore::Histogram &luma);
+    void setHistograms(const imagecore::Histogram &luma, const imagecore::Histogram &red,
+                       const imagecore::Histogram &green, const imagecore::Histogram &blue);
+    void setShowCumulative(bool show);
+    void setShowChannels(bool show);
+    bool showsChannels() const;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    // luma, red, green and blue
+    std::array<imagecore::Histogram, 4> counts = {};
+    std::array<int, 4> maxima = {};
+    // cumulative luma counts, the last one is the pixel count
+    std::array<qint64, GRAY_SPECTRUM> cumulative = {};
+    bool hasChannels = false;
+    bool showCumulative = false;
+    bool showChannels = false;
+};
+
+#endif